@@ -0,0 +1,168 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <sys/un.h>
+#include "../src/settings.hpp"
+#include "protocol.hpp"
+
+/*
+	Sends an image to the conversion server and prints the results as ANSI text, or measures the server with many requests.
+
+	./asciidrawer_client_linux example.bmp
+	--image result.bmp      saves the result image
+	--text result.txt       saves the text instead of printing it
+	--width 80              the width of the results in letters instead of RESULT_WIDTH
+	--threshold 0.1         the quality threshold instead of QUALITY_THRESHOLD
+	--load 1000             sends the image this many times and prints the throughput and the latencies
+	--connections 8         how many requests of --load are sent at the same time
+	--socket path           the socket instead of SERVER_SOCKET
+*/
+
+typedef std::chrono::high_resolution_clock Clock;
+
+// Sends a single request, returns false if the connection fails
+bool convert(const char *path, const RequestHeader &request, const std::vector<char> &input,
+	ResponseHeader &response, std::string &text, std::string &image) {
+
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(address.sun_path)) return false;
+	strcpy(address.sun_path, path);
+	const int connection = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (connection < 0) return false;
+	if (connect(connection, (const sockaddr*)&address, sizeof(address))) {
+		close(connection);
+		return false;
+	}
+
+	// A busy server answers without reading the request, so the response is read even if sending fails
+	if (writeAll(connection, &request, sizeof(request))) writeAll(connection, input.data(), input.size());
+	bool received = readAll(connection, &response, sizeof(response)) && !memcmp(response.magic, RESPONSE_MAGIC, 4);
+	if (received && response.status == STATUS_OK) {
+		text.resize(response.textSize);
+		image.resize(response.imageSize);
+		received = readAll(connection, &text[0], text.size()) && readAll(connection, &image[0], image.size());
+	}
+	close(connection);
+	return received;
+}
+
+// Sends the same request from several threads and prints the statistics
+void generateLoad(const char *path, const RequestHeader &request, const std::vector<char> &input,
+	const unsigned int count, const unsigned int connections) {
+
+	std::mutex mutex;
+	std::vector<double> latencies; // milliseconds of the converted requests
+	double queueTime = 0, convertTime = 0;
+	unsigned int busy = 0, bad = 0, failed = 0;
+	std::atomic<unsigned int> next(0);
+
+	const auto start = Clock::now();
+	std::vector<std::thread> threads;
+	for (unsigned int t = 0; t < connections; t++) {
+		threads.push_back(std::thread([&]() {
+			ResponseHeader response;
+			std::string text, image;
+			while (next++ < count) {
+				const auto requestStart = Clock::now();
+				const bool received = convert(path, request, input, response, text, image);
+				const double latency = std::chrono::duration<double, std::milli>(Clock::now() - requestStart).count();
+				std::lock_guard<std::mutex> lock(mutex);
+				if (!received) failed++;
+				else if (response.status == STATUS_BUSY) busy++;
+				else if (response.status != STATUS_OK) bad++;
+				else {
+					latencies.push_back(latency);
+					queueTime += response.queueTime / 1000.0;
+					convertTime += response.convertTime / 1000.0;
+				}
+			}
+		}));
+	}
+	for (auto &thread : threads) thread.join();
+	const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	std::cout << "Sent " << count << " requests with " << connections << " connections in " << seconds << " seconds: "
+		<< latencies.size() << " converted, " << busy << " busy, " << bad << " bad requests, " << failed << " failed" << std::endl;
+	if (latencies.empty()) return;
+	std::sort(latencies.begin(), latencies.end());
+	double sum = 0;
+	for (const double latency : latencies) sum += latency;
+	std::cout << "Throughput: " << latencies.size() / seconds << " requests per second" << std::endl;
+	std::cout << "Latency: mean " << sum / latencies.size() << " ms, median " << latencies[latencies.size() / 2]
+		<< " ms, 95th percentile " << latencies[latencies.size() * 95 / 100] << " ms, 99th percentile "
+		<< latencies[latencies.size() * 99 / 100] << " ms, max " << latencies.back() << " ms" << std::endl;
+	std::cout << "Server: mean " << queueTime / latencies.size() << " ms waiting for a worker and "
+		<< convertTime / latencies.size() << " ms converting" << std::endl;
+}
+
+int main(int argc, char **argv) {
+	if (argc < 2) {
+		std::cerr << "Usage: " << argv[0] << " input.bmp [--image result.bmp] [--text result.txt] [--width 80] [--threshold 0.1]"
+			" [--load 1000] [--connections 8] [--socket path]" << std::endl;
+		return 1;
+	}
+	const char *imagePath = 0, *textPath = 0, *path = SERVER_SOCKET;
+	unsigned int load = 0, connections = 1;
+	RequestHeader request;
+	memset(&request, 0, sizeof(request));
+	memcpy(request.magic, REQUEST_MAGIC, 4);
+	request.version = PROTOCOL_VERSION;
+	for (int i = 2; i + 1 < argc; i += 2) {
+		if (!strcmp(argv[i], "--image")) imagePath = argv[i + 1];
+		else if (!strcmp(argv[i], "--text")) textPath = argv[i + 1];
+		else if (!strcmp(argv[i], "--width")) request.width = atoi(argv[i + 1]);
+		else if (!strcmp(argv[i], "--threshold")) request.threshold = atof(argv[i + 1]);
+		else if (!strcmp(argv[i], "--load")) load = atoi(argv[i + 1]);
+		else if (!strcmp(argv[i], "--connections")) connections = std::max(1, atoi(argv[i + 1]));
+		else if (!strcmp(argv[i], "--socket")) path = argv[i + 1];
+		else {
+			std::cerr << "Unknown argument " << argv[i] << std::endl;
+			return 1;
+		}
+	}
+
+	std::ifstream file(argv[1], std::ios::binary);
+	std::stringstream contents;
+	contents << file.rdbuf();
+	const std::string data = contents.str();
+	if (!file || data.empty()) {
+		std::cerr << "Couldn't read " << argv[1] << std::endl;
+		return 1;
+	}
+	const std::vector<char> input(data.begin(), data.end());
+	request.inputSize = input.size();
+
+	if (load) {
+		request.flags = REQUEST_TEXT | REQUEST_IMAGE;
+		generateLoad(path, request, input, load, connections);
+		return 0;
+	}
+
+	request.flags = REQUEST_TEXT | (imagePath ? REQUEST_IMAGE : 0);
+	ResponseHeader response;
+	std::string text, image;
+	if (!convert(path, request, input, response, text, image)) {
+		std::cerr << "Couldn't connect to " << path << std::endl;
+		return 1;
+	}
+	if (response.status != STATUS_OK) {
+		std::cerr << (response.status == STATUS_BUSY ? "The server is busy" : "The server couldn't convert the image") << std::endl;
+		return 1;
+	}
+	if (textPath) std::ofstream(textPath, std::ios::binary).write(text.data(), text.size());
+	else std::cout << text << "\033[0m";
+	if (imagePath) std::ofstream(imagePath, std::ios::binary).write(image.data(), image.size());
+	std::cerr << response.width << " x " << response.height << " letters in " << response.convertTime / 1000.0 << " ms" << std::endl;
+	return 0;
+}
@@ -0,0 +1,69 @@
+#ifndef PROTOCOL_HPP
+#define PROTOCOL_HPP
+
+#include <cstdint>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/socket.h>
+
+/*
+	The protocol of the conversion server. The client connects to the Unix socket and sends a request header
+	followed by a bmp-file. The server answers with a response header followed by the ANSI text and the bmp-file
+	of the results if they were requested, and closes the connection. The values are in the byte order
+	of the computer because the socket is local.
+*/
+
+#define PROTOCOL_VERSION 1
+#define REQUEST_MAGIC "ASCQ"
+#define RESPONSE_MAGIC "ASCR"
+
+// The flags of a request
+#define REQUEST_TEXT 1
+#define REQUEST_IMAGE 2
+
+// The statuses of a response
+#define STATUS_OK 0
+#define STATUS_BAD_REQUEST 1 // the request or the image couldn't be read or is too large
+#define STATUS_BUSY 2 // too many connections were waiting, the request wasn't read
+
+struct RequestHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t flags;
+	uint32_t width; // in letters, 0 uses RESULT_WIDTH
+	float threshold; // 0 uses QUALITY_THRESHOLD
+	uint32_t inputSize; // the size of the bmp-file after the header
+};
+
+struct ResponseHeader {
+	char magic[4];
+	uint32_t status;
+	uint32_t width, height; // in letters
+	uint32_t textSize, imageSize; // the sizes of the text and the bmp-file after the header
+	uint32_t queueTime, convertTime; // microseconds spent waiting for a worker and converting
+};
+
+inline bool readAll(const int socket, void *data, size_t size) {
+	while (size) {
+		const ssize_t count = read(socket, data, size);
+		if (count < 0 && errno == EINTR) continue;
+		if (count <= 0) return false;
+		data = (char*)data + count;
+		size -= count;
+	}
+	return true;
+}
+
+// MSG_NOSIGNAL returns an error instead of raising SIGPIPE when the other end has closed the connection
+inline bool writeAll(const int socket, const void *data, size_t size) {
+	while (size) {
+		const ssize_t count = send(socket, data, size, MSG_NOSIGNAL);
+		if (count < 0 && errno == EINTR) continue;
+		if (count <= 0) return false;
+		data = (const char*)data + count;
+		size -= count;
+	}
+	return true;
+}
+
+#endif
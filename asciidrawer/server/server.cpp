@@ -0,0 +1,246 @@
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <string>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <csignal>
+#include <cstring>
+#include <sys/un.h>
+#include <sys/time.h>
+#if defined(_OPENMP)
+	#include <omp.h>
+#endif
+#include "../src/asciidrawer.hpp"
+#include "../src/settings.hpp"
+#include "../src/stats.hpp"
+#include "protocol.hpp"
+
+/*
+	Keeps the font, the tables and the threads ready and converts the images that are sent to SERVER_SOCKET,
+	see protocol.hpp. Every connection sends a single request and gets a single response.
+	SERVER_WORKERS requests are converted at the same time with their share of the OpenMP threads
+	and SERVER_QUEUE connections can wait for a worker, the connections after that are answered as busy.
+	The server stops with SIGINT or SIGTERM after converting the requests that were already accepted.
+*/
+
+// How many seconds a connection can wait between the bytes of a request or a response
+#define SERVER_TIMEOUT 10
+
+typedef std::chrono::high_resolution_clock Clock;
+
+inline uint32_t getMicroseconds(const Clock::time_point &start) {
+	return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+}
+
+class ConversionServer {
+	public:
+		ConversionServer(const Font &font, const MatchSettings &settings):
+			font(font), settings(settings), utf8(createUTF8Table()), closing(false), handled(0), rejected(0), invalid(0) {}
+		// Accepts connections until stopping becomes true
+		bool run(const char *path, const volatile sig_atomic_t &stopping);
+	private:
+		struct Connection {
+			int socket;
+			Clock::time_point accepted;
+		};
+		const Font &font;
+		const MatchSettings settings;
+		const std::vector<UTF8Letter> utf8;
+		std::mutex mutex;
+		std::condition_variable available;
+		std::deque<Connection> queue;
+		bool closing; // the workers end when the queue is empty
+		std::atomic<unsigned int> handled, rejected, invalid;
+		void work(const unsigned int threads);
+		void handle(const Connection &connection, TileRenderer &renderer);
+};
+
+bool ConversionServer::run(const char *path, const volatile sig_atomic_t &stopping) {
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(address.sun_path)) return false;
+	strcpy(address.sun_path, path);
+	const int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	unlink(path);
+	if (listener < 0 || bind(listener, (const sockaddr*)&address, sizeof(address)) || listen(listener, SERVER_QUEUE)) return false;
+
+	#if defined(_OPENMP)
+		const unsigned int threads = std::max(1, omp_get_max_threads() / SERVER_WORKERS);
+	#else
+		const unsigned int threads = 1;
+	#endif
+	std::vector<std::thread> workers;
+	for (unsigned int i = 0; i < SERVER_WORKERS; i++) workers.push_back(std::thread(&ConversionServer::work, this, threads));
+	std::cout << "Listening to " << path << " with " << SERVER_WORKERS << " workers of " << threads << " threads" << std::endl;
+
+	while (!stopping) {
+		Connection connection;
+		connection.socket = accept(listener, 0, 0);
+		connection.accepted = Clock::now();
+		if (connection.socket < 0) continue; // the signals interrupt accept
+		const timeval timeout = {SERVER_TIMEOUT, 0};
+		setsockopt(connection.socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+		setsockopt(connection.socket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+		std::unique_lock<std::mutex> lock(mutex);
+		if (queue.size() >= SERVER_QUEUE) {
+			lock.unlock();
+			ResponseHeader response;
+			memset(&response, 0, sizeof(response));
+			memcpy(response.magic, RESPONSE_MAGIC, 4);
+			response.status = STATUS_BUSY;
+			writeAll(connection.socket, &response, sizeof(response));
+			close(connection.socket);
+			rejected++;
+			continue;
+		}
+		queue.push_back(connection);
+		lock.unlock();
+		available.notify_one();
+	}
+
+	close(listener);
+	unlink(path);
+	std::unique_lock<std::mutex> lock(mutex);
+	closing = true;
+	lock.unlock();
+	available.notify_all();
+	for (auto &worker : workers) worker.join();
+	std::cout << std::endl << "Converted " << handled << " images, " << invalid << " invalid requests and "
+		<< rejected << " connections answered as busy" << std::endl;
+	return true;
+}
+
+void ConversionServer::work(const unsigned int threads) {
+	#if defined(_OPENMP)
+		omp_set_num_threads(threads);
+	#endif
+	// The rendered letters are kept for the later requests of the same worker
+	TileRenderer renderer(font);
+	while (true) {
+		std::unique_lock<std::mutex> lock(mutex);
+		available.wait(lock, [this]() { return !queue.empty() || closing; });
+		if (queue.empty()) return;
+		const Connection connection = queue.front();
+		queue.pop_front();
+		lock.unlock();
+		handle(connection, renderer);
+		close(connection.socket);
+	}
+}
+
+void ConversionServer::handle(const Connection &connection, TileRenderer &renderer) {
+	const auto start = Clock::now();
+	ResponseHeader response;
+	memset(&response, 0, sizeof(response));
+	memcpy(response.magic, RESPONSE_MAGIC, 4);
+	response.status = STATUS_BAD_REQUEST;
+	response.queueTime = std::chrono::duration_cast<std::chrono::microseconds>(start - connection.accepted).count();
+
+	RequestHeader request;
+	std::vector<unsigned char> input;
+	std::unique_ptr<unsigned char[]> image;
+	unsigned int inputWidth = 0, inputHeight = 0;
+	if (readAll(connection.socket, &request, sizeof(request)) && !memcmp(request.magic, REQUEST_MAGIC, 4) &&
+		request.version == PROTOCOL_VERSION && request.inputSize <= SERVER_MAX_INPUT) {
+		input.resize(request.inputSize);
+		if (readAll(connection.socket, input.data(), input.size())) {
+			image.reset(decodeBMP(input.data(), input.size(), "The request", inputWidth, inputHeight));
+		}
+	}
+	const unsigned int width = image && request.width ? request.width : RESULT_WIDTH;
+	const uint64_t height = image ? (font.letterWidth * (uint64_t)inputHeight * width + (font.letterHeight * (uint64_t)inputWidth - 1)) /
+		font.letterHeight / inputWidth : 0;
+	if (!image || width * height > SERVER_MAX_LETTERS) {
+		invalid++;
+		response.convertTime = getMicroseconds(start);
+		writeAll(connection.socket, &response, sizeof(response));
+		return;
+	}
+
+	// Scale and match like the still image version
+	const unsigned int outputWidth = width * font.letterWidth;
+	const unsigned int outputHeight = height * font.letterHeight;
+	if (outputWidth > inputWidth || outputHeight > inputHeight) {
+		image.reset(scaleUp(image.get(), inputWidth, inputHeight, outputWidth, outputHeight));
+	}
+	else if (outputWidth != inputWidth || outputHeight != inputHeight) {
+		image.reset(scaleDown(image.get(), inputWidth, inputHeight, outputWidth, outputHeight));
+	}
+	MatchSettings matchSettings = settings;
+	if (request.threshold > 0) matchSettings.threshold = std::min(request.threshold, 1.0f);
+	std::vector<Result> results(width * height);
+	matchResults(font, image.get(), width, height, matchSettings, results);
+
+	std::string text, result;
+	if (request.flags & REQUEST_TEXT) writeANSI(text, utf8, results, width, height);
+	if (request.flags & REQUEST_IMAGE) {
+		// The scaled input isn't needed anymore, so it's reused for the result image
+		renderer.render(results, width, 0, height, image.get());
+		encodeBMP(image.get(), outputWidth, outputHeight, result);
+	}
+
+	response.status = STATUS_OK;
+	response.width = width;
+	response.height = height;
+	response.textSize = text.size();
+	response.imageSize = result.size();
+	response.convertTime = getMicroseconds(start);
+	handled++;
+	if (writeAll(connection.socket, &response, sizeof(response)) && writeAll(connection.socket, text.data(), text.size())) {
+		writeAll(connection.socket, result.data(), result.size());
+	}
+}
+
+volatile sig_atomic_t stopping = 0;
+
+void stop(int) {
+	stopping = 1;
+}
+
+int main() {
+	Font font;
+	if (!loadFont(font)) {
+		std::cout << "Couldn't load the font" << std::endl;
+		return 1;
+	}
+
+	// The signals interrupt accept because SA_RESTART isn't set
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = stop;
+	sigaction(SIGINT, &action, 0);
+	sigaction(SIGTERM, &action, 0);
+
+	MatchSettings matchSettings;
+	matchSettings.threshold = QUALITY_THRESHOLD;
+	matchSettings.usePrevious = false;
+	matchSettings.showProgress = false;
+	#ifdef PATCH_CACHE_SIZE
+		PatchCache patchCache(PATCH_CACHE_SIZE, PATCH_CACHE_BITS);
+		matchSettings.patchCache = &patchCache;
+	#endif
+	#ifdef TILE_INDEX_CHECKS
+		const TileIndex tileIndex(font, TILE_INDEX_DIMENSIONS, TILE_INDEX_CANDIDATES);
+		matchSettings.tileIndex = &tileIndex;
+		matchSettings.tileChecks = TILE_INDEX_CHECKS;
+	#endif
+
+	ConversionServer server(font, matchSettings);
+	if (!server.run(SERVER_SOCKET, stopping)) {
+		std::cout << "Couldn't listen to " << SERVER_SOCKET << std::endl;
+		return 1;
+	}
+	#ifdef COLLECT_STATS
+		stats.endFrame();
+		stats.saveJSON(STATS_JSON);
+		stats.saveTrace(STATS_TRACE);
+	#endif
+	return 0;
+}
@@ -0,0 +1,181 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <algorithm>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "batch.hpp"
+#include "settings.hpp"
+#include "stats.hpp"
+
+struct BatchImage {
+	std::string input, output;
+	unsigned int width, height; // in letters, 0 if the input couldn't be loaded
+	std::unique_ptr<unsigned char[]> scaled;
+	std::vector<Result> results;
+	double latency; // milliseconds from starting to load the images of its batch to saving its results
+};
+
+inline double getMilliseconds(const std::chrono::high_resolution_clock::time_point &start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+inline void addImage(std::vector<BatchImage> &images, const std::string &input, const std::string &output) {
+	images.push_back(BatchImage());
+	images.back().input = input;
+	images.back().output = output;
+	images.back().width = images.back().height = 0;
+	images.back().latency = 0;
+}
+
+// Find the inputs and outputs from the directory or the list
+bool listBatch(const char *batch, std::vector<BatchImage> &images) {
+	struct stat info;
+	if (stat(batch, &info)) return false;
+	const std::string outputPath = std::string(BATCH_OUTPUT) + "/";
+
+	if (S_ISDIR(info.st_mode)) {
+		DIR *directory = opendir(batch);
+		if (!directory) return false;
+		std::vector<std::string> names;
+		while (const dirent *entry = readdir(directory)) {
+			const std::string name = entry->d_name;
+			if (name.size() > 4 && !name.compare(name.size() - 4, 4, ".bmp")) names.push_back(name);
+		}
+		closedir(directory);
+		std::sort(names.begin(), names.end());
+		for (const auto &name : names) addImage(images, std::string(batch) + "/" + name, outputPath + name);
+	}
+	else {
+		std::ifstream file(batch);
+		if (!file) return false;
+		std::string line;
+		while (std::getline(file, line)) {
+			std::istringstream fields(line);
+			std::string input, output;
+			if (!(fields >> input) || input[0] == '#') continue;
+			if (!(fields >> output)) output = outputPath + input.substr(input.find_last_of('/') + 1);
+			addImage(images, input, output);
+		}
+	}
+	mkdir(BATCH_OUTPUT, 0755);
+	return true;
+}
+
+// Load the input image and scale it to the size of the results
+void loadImage(BatchImage &image, const unsigned int letterWidth, const unsigned int letterHeight) {
+	unsigned int inputWidth, inputHeight;
+	std::unique_ptr<unsigned char[]> input(loadBMP(image.input.c_str(), inputWidth, inputHeight));
+	if (!input) return;
+	image.width = RESULT_WIDTH;
+	image.height = (letterWidth * inputHeight * RESULT_WIDTH + (letterHeight * inputWidth - 1)) / letterHeight / inputWidth;
+	const unsigned int outputWidth = image.width * letterWidth;
+	const unsigned int outputHeight = image.height * letterHeight;
+	if (outputWidth > inputWidth || outputHeight > inputHeight) {
+		image.scaled.reset(scaleUp(input.get(), inputWidth, inputHeight, outputWidth, outputHeight));
+	}
+	else if (outputWidth != inputWidth || outputHeight != inputHeight) {
+		image.scaled.reset(scaleDown(input.get(), inputWidth, inputHeight, outputWidth, outputHeight));
+	}
+	else image.scaled = std::move(input);
+}
+
+bool convertBatch(const Font &font, const char *batch) {
+	std::vector<BatchImage> images;
+	if (!listBatch(batch, images)) {
+		std::cout << "Couldn't read the batch " << batch << std::endl;
+		return false;
+	}
+	std::cout << "Converting " << images.size() << " images" << std::endl;
+
+	MatchSettings matchSettings;
+	matchSettings.threshold = QUALITY_THRESHOLD;
+	matchSettings.usePrevious = false;
+	matchSettings.showProgress = false;
+	#ifdef PATCH_CACHE_SIZE
+		PatchCache patchCache(PATCH_CACHE_SIZE, PATCH_CACHE_BITS);
+		matchSettings.patchCache = &patchCache;
+	#endif
+	#ifdef TILE_INDEX_CHECKS
+		const TileIndex tileIndex(font, TILE_INDEX_DIMENSIONS, TILE_INDEX_CANDIDATES);
+		matchSettings.tileIndex = &tileIndex;
+		matchSettings.tileChecks = TILE_INDEX_CHECKS;
+	#endif
+
+	// The rendered letters are shared by all images
+	TileRenderer renderer(font);
+	#ifdef SAVE_RESULT_TEXT
+		const std::vector<UTF8Letter> utf8 = createUTF8Table();
+	#endif
+
+	const auto start = std::chrono::high_resolution_clock::now();
+	uint64_t letters = 0;
+	unsigned int failed = 0;
+	for (unsigned int first = 0; first < images.size(); first += BATCH_SIZE) {
+		const unsigned int last = std::min<unsigned int>(first + BATCH_SIZE, images.size());
+		const auto batchStart = std::chrono::high_resolution_clock::now();
+
+		// The images are loaded and scaled in parallel and then all their letters are matched together
+		#pragma omp parallel for schedule(dynamic)
+		for (unsigned int i = first; i < last; i++) loadImage(images[i], font.letterWidth, font.letterHeight);
+		std::vector<MatchJob> jobs;
+		for (unsigned int i = first; i < last; i++) {
+			if (!images[i].width) continue;
+			MatchJob job;
+			job.input = images[i].scaled.get();
+			job.width = images[i].width;
+			job.height = images[i].height;
+			job.results = &images[i].results;
+			jobs.push_back(job);
+		}
+		matchBatch(font, jobs, matchSettings);
+
+		for (unsigned int i = first; i < last; i++) {
+			BatchImage &image = images[i];
+			if (!image.width) {
+				std::cout << image.input << ": couldn't load the image" << std::endl;
+				failed++;
+				continue;
+			}
+			bool saved = true;
+			#ifdef SAVE_RESULT_TEXT
+				std::string text;
+				writeANSI(text, utf8, image.results, image.width, image.height);
+				saved = std::ofstream((image.output + ".txt").c_str(), std::ios::binary).write(text.data(), text.size()).good();
+			#endif
+			#ifdef SAVE_RESULT_IMAGE
+				// The scaled input isn't needed anymore, so it's reused for the result image
+				renderer.render(image.results, image.width, 0, image.height, image.scaled.get());
+				saved = saveBMP(image.scaled.get(), image.output.c_str(),
+					image.width * font.letterWidth, image.height * font.letterHeight) && saved;
+			#endif
+			image.latency = getMilliseconds(batchStart);
+			letters += image.results.size();
+			if (!saved) failed++;
+			std::cout << image.input << " -> " << image.output << ": " << image.width << " x " << image.height
+				<< " letters in " << image.latency << " ms" << (saved ? "" : ", couldn't save the results") << std::endl;
+			image.scaled.reset();
+			std::vector<Result>().swap(image.results);
+		}
+	}
+
+	// Throughput of the whole batch and the latencies of the images
+	const double seconds = getMilliseconds(start) / 1000;
+	std::vector<double> latencies;
+	for (const auto &image : images) {
+		if (image.width) latencies.push_back(image.latency);
+	}
+	std::sort(latencies.begin(), latencies.end());
+	std::cout << std::endl << "Converted " << (images.size() - failed) << " / " << images.size() << " images in " << seconds << " seconds: "
+		<< (seconds > 0 ? (images.size() - failed) / seconds : 0) << " images and " << (seconds > 0 ? letters / seconds : 0) << " letters per second" << std::endl;
+	if (!latencies.empty()) {
+		double sum = 0;
+		for (const double latency : latencies) sum += latency;
+		std::cout << "Latency: mean " << sum / latencies.size() << " ms, median " << latencies[latencies.size() / 2]
+			<< " ms, 95th percentile " << latencies[latencies.size() * 95 / 100] << " ms, max " << latencies.back() << " ms" << std::endl;
+	}
+	return !failed;
+}
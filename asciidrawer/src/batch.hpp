@@ -0,0 +1,15 @@
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+#include "asciidrawer.hpp"
+
+/*
+	Converts many images with the same font, tables and threads, see BATCH in settings.hpp.
+	batch is a directory whose bmp-files are converted into BATCH_OUTPUT with the same names
+	or a text file with an input path and optionally an output path on each line.
+	BATCH_SIZE images are loaded, scaled and matched together so that the threads are shared by the letters
+	of all of them, and the latency of every image and the throughput of the whole batch are printed.
+*/
+bool convertBatch(const Font &font, const char *batch);
+
+#endif
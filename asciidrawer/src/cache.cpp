@@ -0,0 +1,52 @@
+#include <cstring>
+#include "asciidrawer.hpp"
+
+PatchCache::PatchCache(const unsigned int maxSize, const unsigned int bits):
+	maxPartSize(maxSize / PARTS + 1), mask(bits < 8 ? 255 << bits : 0), hits(0), misses(0) {}
+
+// FNV-1a
+uint64_t PatchCache::getKey(const unsigned char *input, const unsigned int inputWidth, const unsigned int xs, const unsigned int ys,
+	const unsigned int letterWidth, const unsigned int letterHeight, const MatchSettings &settings) const {
+
+	uint64_t hash = 14695981039346656037ull;
+	for (unsigned int y = ys; y < ys + letterHeight; y++) {
+		const unsigned char *pixel = &input[(xs + y * inputWidth) * 3];
+		for (unsigned int x = 0; x < letterWidth * 3; x++) {
+			hash = (hash ^ (pixel[x] & mask)) * 1099511628211ull;
+		}
+	}
+	uint32_t values[3] = {0, settings.letterLimit, settings.tileChecks};
+	memcpy(&values[0], &settings.threshold, sizeof(float));
+	for (unsigned int i = 0; i < 3; i++) hash = (hash ^ values[i]) * 1099511628211ull;
+	return hash;
+}
+
+void PatchCache::quantize(const unsigned char *input, const unsigned int inputWidth, const unsigned int xs, const unsigned int ys,
+	const unsigned int letterWidth, const unsigned int letterHeight, unsigned char *patch) const {
+
+	const unsigned char middle = ((255 & ~mask) + 1) / 2;
+	for (unsigned int y = ys; y < ys + letterHeight; y++) {
+		const unsigned char *pixel = &input[(xs + y * inputWidth) * 3];
+		for (unsigned int x = 0; x < letterWidth * 3; x++) *patch++ = (pixel[x] & mask) | middle;
+	}
+}
+
+bool PatchCache::find(const uint64_t key, Result &result) {
+	Part &part = parts[key % PARTS];
+	std::lock_guard<std::mutex> lock(part.mutex);
+	const auto found = part.results.find(key);
+	if (found == part.results.end()) {
+		misses++;
+		return false;
+	}
+	hits++;
+	result = found->second;
+	return true;
+}
+
+void PatchCache::insert(const uint64_t key, const Result &result) {
+	Part &part = parts[key % PARTS];
+	std::lock_guard<std::mutex> lock(part.mutex);
+	if (part.results.size() >= maxPartSize) part.results.clear();
+	part.results[key] = result;
+}
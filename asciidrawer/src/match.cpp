@@ -0,0 +1,744 @@
+#include <iostream>
+#include <memory>
+#include <limits>
+#include <cstring>
+#include <cstdint>
+#include <chrono>
+#include <algorithm>
+#include "asciidrawer.hpp"
+#include "settings.hpp"
+#include "stats.hpp"
+#ifdef EMBEDDED_FONT
+	#include "../embed/font.hpp"
+#endif
+
+// The values that stay the same while matching the letters of an image
+struct MatchContext {
+	const Font &font;
+	const unsigned char *input;
+	unsigned int width;
+	// The normal and bold colors and the input image in the color space that is used for comparing the colors
+	unsigned char palette[16][3];
+	std::unique_ptr<unsigned char[]> converted;
+	// The colors of every letter color with every normal and bold foreground color and background color
+	// The bold foreground colors are 8-15 and use the color range of the bold letters
+	std::unique_ptr<unsigned char[]> blends;
+	const unsigned char *getBlend(const unsigned int fg, const unsigned int bg, const unsigned int letterColor) const {
+		return &blends[((fg * 8 + bg) * 256 + letterColor) * 3];
+	}
+	// The sum of the coverages of the letter pixels and the sum of their squares for every letter, bold and underline
+	// The coverage goes from 0 at the background color to 1 at the foreground color
+	std::vector<float> moments;
+	unsigned int space; // the letter with the lowest coverage
+	// The letters are split into blocks that are x, y, width and height, from a single block for the whole letter
+	// to blocks of PYRAMID_BLOCK x PYRAMID_BLOCK pixels, and levels has the first block of each size and the end
+	// For every letter, bold, underline and block the average coverage of the letter from 0 to 1
+	std::vector<unsigned int> blocks;
+	std::vector<unsigned int> levels;
+	std::vector<float> coverages;
+	MatchContext(const Font &font, const unsigned char *input, const unsigned int width, const unsigned int height);
+};
+
+MatchContext::MatchContext(const Font &font, const unsigned char *input, const unsigned int width, const unsigned int height):
+	font(font), input(input), width(width) {
+
+	getMatchColors(palette);
+	#ifdef PERCEPTUAL_METRIC
+		const unsigned int pixels = width * font.letterWidth * height * font.letterHeight;
+		converted.reset(new unsigned char[pixels * 3]);
+		// Every row of letters is converted by the thread that matches it with NUMA_FIRST_TOUCH
+		const unsigned int rowPixels = pixels / height;
+		#pragma omp parallel for schedule(static)
+		for (unsigned int y2 = 0; y2 < height; y2++) {
+			convertPerceptual(&input[y2 * rowPixels * 3], &converted[y2 * rowPixels * 3], rowPixels);
+		}
+		this->input = converted.get();
+	#endif
+
+	blends.reset(new unsigned char[16 * 8 * 256 * 3]);
+	for (unsigned int fg = 0; fg < 16; fg++) {
+		const unsigned char minc = fg < 8 ? font.min1 : font.min2;
+		const unsigned char maxc = fg < 8 ? font.max1 : font.max2;
+		for (unsigned int bg = 0; bg < 8; bg++) {
+			for (unsigned int letterColor = 0; letterColor < 256; letterColor++) {
+				unsigned char *blend = &blends[((fg * 8 + bg) * 256 + letterColor) * 3];
+				for (unsigned int i = 0; i < 3; i++) blend[i] = blendColor(minc, maxc, palette[bg][i], palette[fg][i], letterColor);
+			}
+		}
+	}
+
+	#ifdef UNIFORM_VARIANCE
+		const unsigned int letterArea = font.letterWidth * font.letterHeight;
+		moments.resize(font.letters1.size() * 8);
+		space = 0;
+		for (unsigned int c = 0; c < font.letters1.size(); c++) {
+			for (unsigned int bold = 0; bold < 2; bold++) {
+				const unsigned char *letter = bold ? font.letters1b[c] : font.letters1[c];
+				const unsigned char *underline = bold ? font.underline1b : font.underline1;
+				const float minc = bold ? font.min2 : font.min1;
+				const float range = (bold ? font.max2 : font.max1) - minc;
+				float *moment = &moments[(c * 2 + bold) * 4];
+				for (unsigned int i = 0; i < 4; i++) moment[i] = 0;
+				for (unsigned int letterPos = 0; letterPos < letterArea; letterPos++) {
+					const float coverage = range > 0 ? (letter[letterPos] - minc) / range : 1;
+					const float coverage2 = range > 0 ? (std::max(letter[letterPos], underline[letterPos * 3]) - minc) / range : 1;
+					moment[0] += coverage;
+					moment[1] += coverage * coverage;
+					moment[2] += coverage2;
+					moment[3] += coverage2 * coverage2;
+				}
+			}
+			if (moments[c * 8] < moments[space * 8]) space = c;
+		}
+	#endif
+
+	#ifdef PYRAMID_BLOCK
+		// The block size is halved from the first size that covers the whole letter, so the coarse levels come first
+		unsigned int size = PYRAMID_BLOCK;
+		while (size < font.letterWidth || size < font.letterHeight) size *= 2;
+		for (; size >= PYRAMID_BLOCK; size /= 2) {
+			levels.push_back(blocks.size() / 4);
+			for (unsigned int y = 0; y < font.letterHeight; y += size) {
+				for (unsigned int x = 0; x < font.letterWidth; x += size) {
+					blocks.push_back(x);
+					blocks.push_back(y);
+					blocks.push_back(std::min(size, font.letterWidth - x));
+					blocks.push_back(std::min(size, font.letterHeight - y));
+				}
+			}
+		}
+		levels.push_back(blocks.size() / 4);
+		const unsigned int blockCount = blocks.size() / 4;
+		coverages.resize(font.letters1.size() * 4 * blockCount);
+		for (unsigned int c = 0; c < font.letters1.size(); c++) {
+			for (unsigned int bold = 0; bold < 2; bold++) {
+				const unsigned char *letter = bold ? font.letters1b[c] : font.letters1[c];
+				const unsigned char *underline = bold ? font.underline1b : font.underline1;
+				const int minc = bold ? font.min2 : font.min1;
+				const int range = std::max((bold ? font.max2 : font.max1) - minc, 1);
+				float *coverage = &coverages[(c * 2 + bold) * 2 * blockCount];
+				for (unsigned int block = 0; block < blockCount; block++) {
+					const unsigned int *b = &blocks[block * 4];
+					int sum = 0, sum2 = 0;
+					for (unsigned int y = b[1]; y < b[1] + b[3]; y++) {
+						for (unsigned int x = b[0]; x < b[0] + b[2]; x++) {
+							const unsigned int letterPos = x + y * font.letterWidth;
+							sum += letter[letterPos] - minc;
+							sum2 += std::max(letter[letterPos], underline[letterPos * 3]) - minc;
+						}
+					}
+					coverage[block] = float(sum) / (b[2] * b[3] * range);
+					coverage[block + blockCount] = float(sum2) / (b[2] * b[3] * range);
+				}
+			}
+		}
+	#endif
+}
+
+#ifdef PYRAMID_BLOCK
+// Returns true if a lower bound of the error of a letter reaches the limit, which is found from the blocks of one level
+// The error of a block is at least the amount of its pixels times the squared difference of the average colors,
+// and the average color of the letter is between the unrounded one and one less because blendColor rounds down
+inline bool isErrorAbove(const MatchContext &context, const float *coverage, const float (*means)[3],
+	const unsigned int fg, const unsigned int bg, const float limit, const unsigned int level) {
+
+	const unsigned char *fgColor = context.palette[fg];
+	const unsigned char *bgColor = context.palette[bg];
+	const float difference[3] = {float(fgColor[0] - bgColor[0]), float(fgColor[1] - bgColor[1]), float(fgColor[2] - bgColor[2])};
+	float bound = 0;
+	for (unsigned int block = context.levels[level]; block < context.levels[level + 1]; block++) {
+		float blockBound = 0;
+		for (unsigned int i = 0; i < 3; i++) {
+			float d = means[block][i] - (bgColor[i] + difference[i] * coverage[block]);
+			d = d > 0 ? d : d < -1 ? d + 1 : 0;
+			blockBound += d * d;
+		}
+		bound += blockBound * (context.blocks[block * 4 + 2] * context.blocks[block * 4 + 3]);
+		if (bound >= limit) return true;
+	}
+	return false;
+}
+#endif
+
+#ifdef UNIFORM_VARIANCE
+// Find the result for a letter position whose input is nearly a single color from the mean color of the input
+// The error of a letter with a uniform input only depends on the sum of its coverages and the sum of their squares,
+// so every letter and color can be tested without going through the pixels
+// Returns false if the colors of the input vary too much
+bool matchUniform(const MatchContext &context, const MatchSettings &settings, const unsigned int xs, const unsigned int ys, Result &result) {
+	const Font &font = context.font;
+	const unsigned int letterWidth = font.letterWidth;
+	const unsigned int letterHeight = font.letterHeight;
+	const unsigned int outputWidth = context.width * letterWidth;
+	const float letterArea = letterWidth * letterHeight;
+
+	// The sums of the colors and their squares
+	unsigned int sums[3] = {0, 0, 0}, squares[3] = {0, 0, 0};
+	for (unsigned int y = ys; y < ys + letterHeight; y++) {
+		const unsigned char *pixel = &context.input[(xs + y * outputWidth) * 3];
+		for (unsigned int x = 0; x < letterWidth * 3; x += 3) {
+			for (unsigned int i = 0; i < 3; i++) {
+				sums[i] += pixel[x + i];
+				squares[i] += pixel[x + i] * pixel[x + i];
+			}
+		}
+	}
+	float mean[3], variance = 0;
+	for (unsigned int i = 0; i < 3; i++) {
+		mean[i] = sums[i] / letterArea;
+		variance += squares[i] / letterArea - mean[i] * mean[i];
+	}
+	if (variance > UNIFORM_VARIANCE) return false;
+
+	// With the background color bg and the difference d of the foreground color from it,
+	// the error of a letter is the sum of |bg - mean|^2 + 2 * coverage * (bg - mean) * d + coverage^2 * |d|^2
+	float errors[16][8][3];
+	for (unsigned int fg = 0; fg < 16; fg++) {
+		for (unsigned int bg = 0; bg < 8; bg++) {
+			errors[fg][bg][0] = errors[fg][bg][1] = errors[fg][bg][2] = 0;
+			for (unsigned int i = 0; i < 3; i++) {
+				const float e = context.palette[bg][i] - mean[i];
+				const float d = context.palette[fg][i] - context.palette[bg][i];
+				errors[fg][bg][0] += e * e * letterArea;
+				errors[fg][bg][1] += 2 * e * d;
+				errors[fg][bg][2] += d * d;
+			}
+		}
+	}
+
+	// Without UNIFORM_DITHER only the emptiest letter without an underline is tested,
+	// so the input becomes the closest background color
+	#ifdef UNIFORM_DITHER
+		const unsigned int firstLetter = 0;
+		const unsigned int letterCount = settings.letterLimit && settings.letterLimit < font.letters1.size() ?
+			settings.letterLimit : font.letters1.size();
+		const unsigned int underlineCount = 2;
+	#else
+		const unsigned int firstLetter = context.space;
+		const unsigned int letterCount = context.space + 1;
+		const unsigned int underlineCount = 1;
+	#endif
+
+	float best = std::numeric_limits<float>::max();
+	for (unsigned int c = firstLetter; c < letterCount; c++) {
+		for (unsigned int bold = 0; bold < 2; bold++) {
+			for (unsigned int underline = 0; underline < underlineCount; underline++) {
+				const float *moment = &context.moments[(c * 2 + bold) * 4 + underline * 2];
+				for (unsigned int fg = 0; fg < 8; fg++) {
+					const auto &fgErrors = errors[bold ? fg + 8 : fg];
+					for (unsigned int bg = 0; bg < 8; bg++) {
+						const float error = fgErrors[bg][0] + moment[0] * fgErrors[bg][1] + moment[1] * fgErrors[bg][2];
+						if (error < best) {
+							best = error;
+							result.c = c;
+							result.fg = fg;
+							result.bg = bg;
+							result.bold = bold;
+							result.underline = underline;
+						}
+					}
+				}
+			}
+		}
+	}
+	return true;
+}
+#endif
+
+// Find the result for a letter position from the closest candidates of the tile index, which are compared pixel by pixel
+// The quality threshold isn't used because only a few candidates are compared, settings.tileChecks sets the quality instead
+// Returns the amount of the compared candidates
+// The input is usually context.input, but it can also be a single patch
+unsigned int matchIndexed(const MatchContext &context, const MatchSettings &settings, const unsigned char *input, const unsigned int inputWidth,
+	const unsigned int xs, const unsigned int ys, Result &result) {
+
+	const Font &font = context.font;
+	const unsigned int letterWidth = font.letterWidth;
+	const unsigned int letterHeight = font.letterHeight;
+	const unsigned int letterCount = settings.letterLimit && settings.letterLimit < font.letters1.size() ? settings.letterLimit : font.letters1.size();
+
+	std::vector<Result> candidates;
+	settings.tileIndex->search(input, inputWidth, xs, ys, settings.tileChecks, candidates);
+	// The results of the patch cache mustn't depend on the previous results
+	if (settings.usePrevious && !settings.patchCache) candidates.push_back(result);
+
+	int best = std::numeric_limits<int>::max();
+	for (const Result &candidate : candidates) {
+		if (candidate.c >= letterCount) continue;
+		const unsigned char *letter = candidate.bold ? font.letters1b[candidate.c] : font.letters1[candidate.c];
+		const unsigned char *underline = candidate.bold ? font.underline1b : font.underline1;
+		const unsigned int fg2 = candidate.bold ? candidate.fg + 8 : candidate.fg;
+		int error = 0;
+		for (unsigned int y = 0; y < letterHeight && error < best; y++) {
+			const unsigned char *pixel = &input[(xs + (ys + y) * inputWidth) * 3];
+			for (unsigned int x = 0; x < letterWidth; x++, pixel += 3) {
+				const unsigned int letterPos = x + y * letterWidth;
+				const unsigned char letterColor = candidate.underline ?
+					std::max(letter[letterPos], underline[letterPos * 3]) : letter[letterPos];
+				const unsigned char *blend = context.getBlend(fg2, candidate.bg, letterColor);
+				const int letterColorR = blend[0] - pixel[0];
+				const int letterColorG = blend[1] - pixel[1];
+				const int letterColorB = blend[2] - pixel[2];
+				error += letterColorR * letterColorR + letterColorG * letterColorG + letterColorB * letterColorB;
+			}
+		}
+		if (error < best) {
+			best = error;
+			result = candidate;
+		}
+	}
+	return candidates.size();
+}
+
+// Find the best matching letter for a single letter position
+// With settings.usePrevious the current result is tested first
+void matchLetter(const MatchContext &context, const MatchSettings &settings, const unsigned int x2, const unsigned int y2, Result &result) {
+	const Font &font = context.font;
+	const unsigned char *input = context.input; // can be replaced by the patch of the patch cache below
+	const auto &palette = context.palette;
+	#ifdef EMBEDDED_FONT
+		// The letter size of the embedded font is known when compiling, so the loops over the letter pixels can be unrolled
+		const unsigned int letterWidth = EMBEDDED_LETTER_WIDTH;
+		const unsigned int letterHeight = EMBEDDED_LETTER_HEIGHT;
+	#else
+		const unsigned int letterWidth = font.letterWidth;
+		const unsigned int letterHeight = font.letterHeight;
+	#endif
+	const auto &letters1 = font.letters1;
+	const auto &letters1b = font.letters1b;
+	const auto &underline1 = font.underline1;
+	const auto &underline1b = font.underline1b;
+	const unsigned char min1 = font.min1, max1 = font.max1;
+	const unsigned char min2 = font.min2, max2 = font.max2;
+
+	unsigned int outputWidth = context.width * letterWidth;
+	const unsigned int letterArea = letterWidth * letterHeight;
+	const unsigned int letterCount = settings.letterLimit && settings.letterLimit < letters1.size() ? settings.letterLimit : letters1.size();
+	unsigned int ys = y2 * letterHeight;
+	unsigned int ye = ys + letterHeight;
+
+	unsigned int xs = x2 * letterWidth;
+	unsigned int xe = xs + letterWidth;
+
+	STATS(MatchCounters counters;)
+	STATS(const auto cellStart = std::chrono::high_resolution_clock::now();)
+
+	#ifdef UNIFORM_VARIANCE
+		if (matchUniform(context, settings, xs, ys, result)) {
+			STATS(counters.cells++;)
+			STATS(counters.uniformCells++;)
+			STATS(stats.addCell(x2 + y2 * context.width, counters, cellStart);)
+			return;
+		}
+	#endif
+
+	// Letter positions with the same input as an earlier one get the same result
+	uint64_t cacheKey = 0;
+	std::unique_ptr<unsigned char[]> patch;
+	if (settings.patchCache) {
+		cacheKey = settings.patchCache->getKey(input, outputWidth, xs, ys, letterWidth, letterHeight, settings);
+		if (settings.patchCache->find(cacheKey, result)) {
+			STATS(counters.cells++;)
+			STATS(counters.cacheHits++;)
+			STATS(stats.addCell(x2 + y2 * context.width, counters, cellStart);)
+			return;
+		}
+		STATS(counters.cacheMisses++;)
+
+		// The result is matched from the patch of the key, so it is the same for every letter position with the key
+		patch.reset(new unsigned char[letterArea * 3]);
+		settings.patchCache->quantize(input, outputWidth, xs, ys, letterWidth, letterHeight, patch.get());
+		input = patch.get();
+		outputWidth = letterWidth;
+		xs = ys = 0;
+		xe = letterWidth;
+		ye = letterHeight;
+	}
+
+	if (settings.tileIndex) {
+		#ifdef COLLECT_STATS
+			counters.candidates += matchIndexed(context, settings, input, outputWidth, xs, ys, result);
+		#else
+			matchIndexed(context, settings, input, outputWidth, xs, ys, result);
+		#endif
+		if (settings.patchCache) settings.patchCache->insert(cacheKey, result);
+		STATS(counters.cells++;)
+		STATS(stats.addCell(x2 + y2 * context.width, counters, cellStart);)
+		return;
+	}
+
+	int best = std::numeric_limits<int>::max() / 2;
+
+	// Create lookup tables for all normal and bold colors for the current patch of the original image
+	// This speedup works better if the letter images contain many fully dark/bright pixels
+	const std::unique_ptr<unsigned int[]> lookup(new unsigned int[letterArea * 16]);
+	unsigned int i = 0;
+	for (unsigned char c = 0; c < 16; c++) {
+		const short r = palette[c][0];
+		const short g = palette[c][1];
+		const short b = palette[c][2];
+		for (unsigned int y = ys; y < ye; y++) {
+			for (unsigned int x = xs; x < xe; x++) {
+				const int letterColorR = r - input[(x + y * outputWidth) * 3    ];
+				const int letterColorG = g - input[(x + y * outputWidth) * 3 + 1];
+				const int letterColorB = b - input[(x + y * outputWidth) * 3 + 2];
+				lookup[i] = letterColorR * letterColorR + letterColorG * letterColorG + letterColorB * letterColorB;
+				i++;
+			}
+		}
+	}
+
+	// The quality threshold in 16.16 fixed point, see the dynamic threshold below
+	const int64_t thresholdStart = int64_t(settings.threshold * (1 << 16) + 0.5f);
+
+	// The average colors of the input in the blocks of the letters
+	// The letters are only skipped by the blocks when the threshold is at least 1, because with a lower threshold the sums
+	// below can stop growing and continue when the threshold rises, so a letter can be accepted by the error of only
+	// a part of its pixels, which is not limited by the error of the whole letter
+	// With the threshold 1 the sums either reach the full error or stop at the best error, so the results are the same
+	#ifdef PYRAMID_BLOCK
+		const bool bounded = thresholdStart >= (1 << 16);
+		const unsigned int blockCount = bounded ? context.blocks.size() / 4 : 0;
+		const std::unique_ptr<float[][3]> blockMeans(new float[blockCount][3]);
+		for (unsigned int block = 0; block < blockCount; block++) {
+			const unsigned int *b = &context.blocks[block * 4];
+			unsigned int sums[3] = {0, 0, 0};
+			for (unsigned int y = ys + b[1]; y < ys + b[1] + b[3]; y++) {
+				for (unsigned int x = xs + b[0]; x < xs + b[0] + b[2]; x++) {
+					for (unsigned int i = 0; i < 3; i++) sums[i] += input[(x + y * outputWidth) * 3 + i];
+				}
+			}
+			for (unsigned int i = 0; i < 3; i++) blockMeans[block][i] = float(sums[i]) / (b[2] * b[3]);
+		}
+	#endif
+
+	// First check the current result which is the result that was got in the previous frame for videos
+	// The results of the patch cache mustn't depend on the previous results, so then it isn't checked first
+	bool first = settings.usePrevious && !settings.patchCache;
+
+	// Go through letters, bold and colors
+	for (unsigned char c = 0; c < letterCount; c++) {
+		for (unsigned char fg = 0; fg < 8; fg++) {
+			for (unsigned char bg = 0; bg < 8; bg++) {
+				for (unsigned char bold = 0; bold < 2; bold++) {
+					if (first) {
+						c = result.c;
+						fg = result.fg;
+						bg = result.bg;
+						bold = result.bold;
+					}
+					// This can be skipped because one of the letters should be empty (space character)
+					else if (!bold && fg == bg) continue;
+					STATS(counters.candidates++;)
+
+					// Optimize by calculating some values
+					const short minc = bold ? min2 : min1;
+					const short maxc = bold ? max2 : max1;
+					const auto &letter = bold ? letters1b[c] : letters1[c];
+					const unsigned int fg2 = bold ? fg + 8 : fg;
+
+					const unsigned int letterArea_bg = letterArea * bg;
+					const unsigned int letterArea_fg = letterArea * fg2;
+
+					// Skip the letter if the lower bounds of its errors with and without the underline are too large to be accepted
+					// The coarse levels are cheaper, so the finer levels are only checked for the letters that they don't skip
+					// The limit is a bit larger than the best error so that the float rounding can't skip a better letter
+					#ifdef PYRAMID_BLOCK
+						if (bounded && !first) {
+							const float *coverage = &context.coverages[(c * 2 + bold) * 2 * blockCount];
+							const float limit = best * 1.001f + 1.0f;
+							bool above = false, aboveUnderline = false;
+							for (unsigned int level = 0; level + 1 < context.levels.size() && !(above && aboveUnderline); level++) {
+								if (!above) above = isErrorAbove(context, coverage, blockMeans.get(), fg2, bg, limit, level);
+								if (!aboveUnderline) aboveUnderline = isErrorAbove(context, coverage + blockCount, blockMeans.get(), fg2, bg, limit, level);
+							}
+							if (above && aboveUnderline) {
+								STATS(counters.boundExits++;)
+								continue;
+							}
+						}
+					#endif
+
+					int sum1 = 0, sum2 = 0;
+
+					// Dynamic threshold that is used to exit early if the color difference is growing too big
+					// The threshold is in 16.16 fixed point so that the results don't depend on the float rounding
+					const int64_t threshold_delta = (1 << 16) / int64_t(letterArea);
+					int64_t threshold = thresholdStart;
+					int threshold2 = 0; // threshold2 is just an optimization
+
+					// Go through the current input image patch
+					for (unsigned int y = ys; y < ye; y++) {
+						const int letterY = letterWidth * (y - ys) - xs;
+
+						for (unsigned int x = xs; x < xe; x++) {
+							const unsigned int letterPos = x + letterY;
+							const short letterColor = letter[letterPos];
+
+							STATS(counters.pixels++;)
+							threshold += threshold_delta;
+							threshold2 = threshold > (1 << 16) ? best : (best * threshold) >> 16;
+
+							// Without underline
+							int increase = -1; // this value will also be used for the underline-case if the underline doesn't affect this pixel
+							if (sum1 < threshold2) {
+								// Use lookup tables
+								if (letterColor == minc) {
+									increase = lookup[letterPos + letterArea_bg];
+									STATS(counters.lookupHits++;)
+								}
+								else if (letterColor == maxc) {
+									increase = lookup[letterPos + letterArea_fg];
+									STATS(counters.lookupHits++;)
+								}
+								else {
+									STATS(counters.lookupMisses++;)
+									const unsigned char *blend = context.getBlend(fg2, bg, letterColor);
+									const int letterColorR = blend[0] - input[(x + y * outputWidth) * 3    ];
+									const int letterColorG = blend[1] - input[(x + y * outputWidth) * 3 + 1];
+									const int letterColorB = blend[2] - input[(x + y * outputWidth) * 3 + 2];
+									increase = letterColorR * letterColorR + letterColorG * letterColorG + letterColorB * letterColorB;
+								}
+								sum1 += increase;
+							}
+
+							// With underline
+							if (sum2 < threshold2) {
+								short letterColor2 = (bold ? underline1b : underline1)[letterPos * 3];
+								if (letterColor > letterColor2) letterColor2 = letterColor;
+
+								// Check if all calculations can be skipped
+								if (letterColor2 == letterColor && increase != -1) {
+									sum2 += increase;
+								}
+								else {
+									// Use lookup tables
+									if (letterColor2 == minc) {
+										sum2 += lookup[letterPos + letterArea_bg];
+										STATS(counters.lookupHits++;)
+									}
+									else if (letterColor2 == maxc) {
+										sum2 += lookup[letterPos + letterArea_fg];
+										STATS(counters.lookupHits++;)
+									}
+									else {
+										STATS(counters.lookupMisses++;)
+										const unsigned char *blend = context.getBlend(fg2, bg, letterColor2);
+										const int letterColorR = blend[0] - input[(x + y * outputWidth) * 3    ];
+										const int letterColorG = blend[1] - input[(x + y * outputWidth) * 3 + 1];
+										const int letterColorB = blend[2] - input[(x + y * outputWidth) * 3 + 2];
+										sum2 += letterColorR * letterColorR + letterColorG * letterColorG + letterColorB * letterColorB;
+									}
+								}
+							}
+
+							// Early exit
+							else if (sum1 >= threshold2) {
+								STATS(counters.earlyExits++;)
+								y = ye;
+								x = xe;
+							}
+						}
+					}
+
+					// Update results
+					if (sum1 < threshold2) {
+						best = sum1;
+						result.c = c;
+						result.fg = fg;
+						result.bg = bg;
+						result.bold = bold;
+						result.underline = false;
+					}
+					// can't use threshold2 anymore because best might be updated
+					if (threshold > (1 << 16)) threshold = 1 << 16;
+					if (sum2 < (best * threshold) >> 16) {
+						best = sum2;
+						result.c = c;
+						result.fg = fg;
+						result.bg = bg;
+						result.bold = bold;
+						result.underline = true;
+					}
+					if (first) {
+						c = 0;
+						fg = 0;
+						bg = 0;
+						bold = 0;
+						first = false;
+					}
+
+				}
+			}
+		}
+	}
+
+	if (settings.patchCache) settings.patchCache->insert(cacheKey, result);
+
+	STATS(counters.cells++;)
+	STATS(stats.addCell(x2 + y2 * context.width, counters, cellStart);)
+}
+
+// Find the best matching letters for the input image
+// The input image must already be scaled to the size of the result image
+void matchResults(const Font &font, const unsigned char *input, const unsigned int width, const unsigned int height,
+	const MatchSettings &settings, std::vector<Result> &results) {
+
+	#ifdef BLOCK_MODE
+		solveBlocks(font, input, width, height, settings, results);
+		return;
+	#endif
+
+	// There are too many colors to test them all with the larger palettes
+	if (COLOR_MODE) {
+		solveResults(font, input, width, height, settings, results);
+		return;
+	}
+
+	STATS(StatsTimer timer("match");)
+	const MatchContext context(font, input, width, height);
+	results.resize(width * height);
+
+	// Go through the letter positions in the resulting image
+	#ifdef NUMA_FIRST_TOUCH
+		// Every thread matches a band of rows that it first touched when scaling, so the progress isn't shown
+		#pragma omp parallel for schedule(static)
+		for (unsigned int y2 = 0; y2 < height; y2++) {
+			for (unsigned int x2 = 0; x2 < width; x2++) {
+				matchLetter(context, settings, x2, y2, results[x2 + y2 * width]);
+			}
+		}
+	#else
+		for (unsigned int y2 = 0; y2 < height; y2++) {
+			if (settings.showProgress) std::cout << (y2 + 1) << " / " << height << "\r" << std::flush;
+
+			#pragma omp parallel for schedule(dynamic)
+			for (unsigned int x2 = 0; x2 < width; x2++) {
+				matchLetter(context, settings, x2, y2, results[x2 + y2 * width]);
+			}
+		}
+	#endif
+}
+
+// Find the best matching letters for several input images at once
+// The letter positions of all images are shared by the threads, so small images don't leave threads idle
+void matchBatch(const Font &font, const std::vector<MatchJob> &jobs, const MatchSettings &settings) {
+	// The block letters and the colors of the larger palettes are solved quickly one image at a time
+	bool solved = COLOR_MODE != 0;
+	#ifdef BLOCK_MODE
+		solved = true;
+	#endif
+	if (solved) {
+		for (const auto &job : jobs) matchResults(font, job.input, job.width, job.height, settings, *job.results);
+		return;
+	}
+
+	STATS(StatsTimer timer("match_batch");)
+	std::vector<std::unique_ptr<MatchContext>> contexts(jobs.size());
+	std::vector<unsigned int> offsets(jobs.size() + 1, 0);
+	for (unsigned int j = 0; j < jobs.size(); j++) {
+		jobs[j].results->resize(jobs[j].width * jobs[j].height);
+		offsets[j + 1] = offsets[j] + jobs[j].width * jobs[j].height;
+	}
+
+	#pragma omp parallel for schedule(dynamic)
+	for (unsigned int j = 0; j < jobs.size(); j++) {
+		contexts[j].reset(new MatchContext(font, jobs[j].input, jobs[j].width, jobs[j].height));
+	}
+
+	#pragma omp parallel for schedule(dynamic, 16)
+	for (unsigned int i = 0; i < offsets.back(); i++) {
+		const unsigned int j = std::upper_bound(offsets.begin(), offsets.end(), i) - offsets.begin() - 1;
+		const unsigned int cell = i - offsets[j];
+		matchLetter(*contexts[j], settings, cell % jobs[j].width, cell / jobs[j].width, (*jobs[j].results)[cell]);
+	}
+}
+
+ProgressiveMatcher::ProgressiveMatcher(const Font &font): font(font), next(0) {}
+
+ProgressiveMatcher::~ProgressiveMatcher() {}
+
+void ProgressiveMatcher::start(const unsigned char *input, const unsigned int width, const unsigned int height,
+	std::vector<Result> &results) {
+
+	order.clear();
+	next = 0;
+
+	// The block letters and the colors of the larger palettes are solved quickly, so there is nothing to refine
+	bool solved = COLOR_MODE != 0;
+	#ifdef BLOCK_MODE
+		solved = true;
+	#endif
+	if (solved) {
+		MatchSettings settings;
+		matchResults(font, input, width, height, settings, results);
+		return;
+	}
+
+	STATS(StatsTimer timer("match_first_pass");)
+	context.reset(new MatchContext(font, input, width, height));
+	results.assign(width * height, Result());
+
+	const unsigned int letterWidth = font.letterWidth;
+	const unsigned int letterHeight = font.letterHeight;
+	const unsigned int outputWidth = width * letterWidth;
+	std::vector<std::pair<int, unsigned int>> errors(width * height);
+
+	// Fill every letter position with a space that has the closest background color to the average color
+	#pragma omp parallel for schedule(dynamic)
+	for (unsigned int y2 = 0; y2 < height; y2++) {
+		for (unsigned int x2 = 0; x2 < width; x2++) {
+			const unsigned int xs = x2 * letterWidth;
+			const unsigned int ys = y2 * letterHeight;
+
+			int errors8[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+			for (unsigned int y = ys; y < ys + letterHeight; y++) {
+				const unsigned char *pixel = &context->input[(xs + y * outputWidth) * 3];
+				for (unsigned int x = 0; x < letterWidth * 3; x += 3) {
+					for (unsigned int bg = 0; bg < 8; bg++) {
+						const int r = context->palette[bg][0] - pixel[x];
+						const int g = context->palette[bg][1] - pixel[x + 1];
+						const int b = context->palette[bg][2] - pixel[x + 2];
+						errors8[bg] += r * r + g * g + b * b;
+					}
+				}
+			}
+
+			const unsigned int cell = x2 + y2 * width;
+			unsigned int best = 0;
+			for (unsigned int bg = 1; bg < 8; bg++) {
+				if (errors8[bg] < errors8[best]) best = bg;
+			}
+			results[cell].bg = best;
+			errors[cell] = std::make_pair(errors8[best], cell);
+		}
+	}
+
+	// Refine the letter positions with the largest errors first
+	std::stable_sort(errors.begin(), errors.end(),
+		[](const std::pair<int, unsigned int> &a, const std::pair<int, unsigned int> &b) { return a.first > b.first; });
+	order.resize(errors.size());
+	for (unsigned int i = 0; i < errors.size(); i++) order[i] = errors[i].second;
+}
+
+bool ProgressiveMatcher::refine(const MatchSettings &settings, const double timeLimit, std::vector<Result> &results) {
+	STATS(StatsTimer timer("match_refine");)
+	const auto refineStart = std::chrono::high_resolution_clock::now();
+
+	// The time is only checked between the batches so that the threads are kept busy
+	while (next < order.size()) {
+		const unsigned int batchEnd = std::min<unsigned int>(next + context->width, order.size());
+
+		#pragma omp parallel for schedule(dynamic)
+		for (unsigned int i = next; i < batchEnd; i++) {
+			const unsigned int cell = order[i];
+			matchLetter(*context, settings, cell % context->width, cell / context->width, results[cell]);
+		}
+		next = batchEnd;
+
+		if (settings.showProgress) std::cout << next << " / " << order.size() << "\r" << std::flush;
+		const auto now = std::chrono::high_resolution_clock::now();
+		if (timeLimit > 0 && std::chrono::duration<double, std::milli>(now - refineStart).count() >= timeLimit) break;
+	}
+	return next < order.size();
+}
@@ -0,0 +1,306 @@
+#include <iostream>
+#include <memory>
+#include <limits>
+#include <algorithm>
+#include <cstring>
+#include "asciidrawer.hpp"
+#include "settings.hpp"
+#include "stats.hpp"
+
+// Converts RGB into luma and chroma, where the chroma is scaled by CHROMA_WEIGHT
+const float PERCEPTUAL[3][3] = {
+	{ 0.299f,                     0.587f,                     0.114f},
+	{-0.168736f * CHROMA_WEIGHT, -0.331264f * CHROMA_WEIGHT,  0.5f * CHROMA_WEIGHT},
+	{ 0.5f * CHROMA_WEIGHT,      -0.418688f * CHROMA_WEIGHT, -0.081312f * CHROMA_WEIGHT},
+};
+
+// The products of every RGB value and the conversion factors in 16.16 fixed point
+// The chroma is offset by 128 so that all converted values fit into a byte
+struct PerceptualTables {
+	int values[3][3][256];
+	PerceptualTables() {
+		for (unsigned int i = 0; i < 3; i++) {
+			for (unsigned int j = 0; j < 3; j++) {
+				for (unsigned int v = 0; v < 256; v++) {
+					values[i][j][v] = int(PERCEPTUAL[i][j] * v * 65536.0f) + (j ? 0 : (i ? 128 : 0) * 65536 + 32768);
+				}
+			}
+		}
+	}
+};
+
+// Convert the RGB pixels into the color space of PERCEPTUAL_METRIC, the input and output can be the same
+void convertPerceptual(const unsigned char *input, unsigned char *output, const unsigned int pixels) {
+	static const PerceptualTables tables;
+	for (unsigned int i = 0; i < pixels * 3; i += 3) {
+		const unsigned char r = input[i], g = input[i + 1], b = input[i + 2];
+		for (unsigned int j = 0; j < 3; j++) {
+			const int value = (tables.values[j][0][r] + tables.values[j][1][g] + tables.values[j][2][b]) >> 16;
+			output[i + j] = std::min(std::max(value, 0), 255);
+		}
+	}
+}
+
+// The normal and bold colors in the color space that is used for comparing the colors
+void getMatchColors(unsigned char (*colors)[3]) {
+	for (unsigned int c = 0; c < 8; c++) {
+		memcpy(colors[c], COLORS[c], 3);
+		memcpy(colors[c + 8], COLORS2[c], 3);
+	}
+	#ifdef PERCEPTUAL_METRIC
+		convertPerceptual(colors[0], colors[0], 16);
+	#endif
+}
+
+// The xterm 256 color palette and the closest palette color for every RGB value with 5 bits per channel
+// The closest colors are also found from the first 16 and 8 colors, which are the default foreground and background colors
+struct Palette {
+	unsigned char colors[256][3];
+	unsigned char nearest[32 * 32 * 32], nearest16[32 * 32 * 32], nearest8[32 * 32 * 32];
+	// The squared distance of two colors with RGB difference d is the sum of d[i] * d[j] * metric[i][j]
+	float metric[3][3];
+	Palette();
+	void findNearest(unsigned char *table, const unsigned int amount);
+};
+
+Palette::Palette() {
+	for (unsigned int i = 0; i < 3; i++) {
+		for (unsigned int j = 0; j < 3; j++) {
+			#ifdef PERCEPTUAL_METRIC
+				metric[i][j] = 0;
+				for (unsigned int k = 0; k < 3; k++) metric[i][j] += PERCEPTUAL[k][i] * PERCEPTUAL[k][j];
+			#else
+				metric[i][j] = i == j;
+			#endif
+		}
+	}
+
+	// The first 16 colors are the normal and bold colors from the settings
+	for (unsigned int i = 0; i < 8; i++) {
+		for (unsigned int j = 0; j < 3; j++) {
+			colors[i][j] = COLORS[i][j];
+			colors[i + 8][j] = COLORS2[i][j];
+		}
+	}
+	// 6x6x6 color cube
+	const unsigned char levels[6] = {0, 95, 135, 175, 215, 255};
+	for (unsigned int i = 0; i < 216; i++) {
+		colors[i + 16][0] = levels[i / 36];
+		colors[i + 16][1] = levels[i / 6 % 6];
+		colors[i + 16][2] = levels[i % 6];
+	}
+	// Gray ramp
+	for (unsigned int i = 0; i < 24; i++) {
+		colors[i + 232][0] = colors[i + 232][1] = colors[i + 232][2] = 8 + i * 10;
+	}
+
+	findNearest(nearest, 256);
+	findNearest(nearest16, 16);
+	findNearest(nearest8, 8);
+}
+
+// Find the closest of the first amount colors for the center of every 5-bit RGB cell
+void Palette::findNearest(unsigned char *table, const unsigned int amount) {
+	for (unsigned int i = 0; i < 32 * 32 * 32; i++) {
+		const int r = (i >> 10) * 8 + 4;
+		const int g = (i >> 5 & 31) * 8 + 4;
+		const int b = (i & 31) * 8 + 4;
+		float best = std::numeric_limits<float>::max();
+		for (unsigned int c = 0; c < amount; c++) {
+			const float d[3] = {float(r - colors[c][0]), float(g - colors[c][1]), float(b - colors[c][2])};
+			float distance = 0;
+			for (unsigned int j = 0; j < 3; j++) {
+				for (unsigned int k = 0; k < 3; k++) distance += d[j] * d[k] * metric[j][k];
+			}
+			if (distance < best) {
+				best = distance;
+				table[i] = c;
+			}
+		}
+	}
+}
+
+inline const Palette &getPalette() {
+	static const Palette palette;
+	return palette;
+}
+
+// Returns the RGB values of the foreground and background colors of a result
+void getResultColors(const Result &result, unsigned char *fg, unsigned char *bg) {
+	if (COLOR_MODE == 0) {
+		memcpy(fg, result.bold ? COLORS2[result.fg] : COLORS[result.fg], 3);
+		memcpy(bg, COLORS[result.bg], 3);
+	}
+	else if (COLOR_MODE == 1) {
+		memcpy(fg, getPalette().colors[result.fg], 3);
+		memcpy(bg, getPalette().colors[result.bg], 3);
+	}
+	else {
+		fg[0] = result.fg >> 16;
+		fg[1] = result.fg >> 8;
+		fg[2] = result.fg;
+		bg[0] = result.bg >> 16;
+		bg[1] = result.bg >> 8;
+		bg[2] = result.bg;
+	}
+}
+
+// Returns the squared distance of two colors with PERCEPTUAL_METRIC or in RGB
+float getColorDistance(const float *color1, const float *color2) {
+	const Palette &palette = getPalette();
+	const float d[3] = {color1[0] - color2[0], color1[1] - color2[1], color1[2] - color2[2]};
+	float distance = 0;
+	for (unsigned int i = 0; i < 3; i++) {
+		for (unsigned int j = 0; j < 3; j++) distance += d[i] * d[j] * palette.metric[i][j];
+	}
+	return distance;
+}
+
+// Returns the color of the result that is closest to the given color and its RGB values
+// With the default colors the foreground can also be one of the bold colors, which are returned as 8-15
+unsigned int getNearestColor(const float *color, int *rgb, const bool foreground) {
+	for (unsigned int i = 0; i < 3; i++) rgb[i] = std::min(std::max(int(color[i] + 0.5f), 0), 255);
+	if (COLOR_MODE == 2) return rgb[0] << 16 | rgb[1] << 8 | rgb[2];
+
+	const Palette &palette = getPalette();
+	const unsigned int index = (rgb[0] >> 3) << 10 | (rgb[1] >> 3) << 5 | rgb[2] >> 3;
+	const unsigned int c = COLOR_MODE == 1 ? palette.nearest[index] : foreground ? palette.nearest16[index] : palette.nearest8[index];
+	for (unsigned int i = 0; i < 3; i++) rgb[i] = palette.colors[c][i];
+	return c;
+}
+
+// Find the best matching letters for the input image with the 256 color palette or true colors
+// Instead of testing every color, the foreground and background colors that best reproduce the input are solved
+// with least squares for every letter and then replaced with the closest available colors
+// PERCEPTUAL_METRIC is used for the closest colors and the errors, so the input image stays in RGB
+void solveResults(const Font &font, const unsigned char *input, const unsigned int width, const unsigned int height,
+	const MatchSettings &settings, std::vector<Result> &results) {
+
+	const unsigned int letterWidth = font.letterWidth;
+	const unsigned int letterHeight = font.letterHeight;
+	const unsigned int letterArea = letterWidth * letterHeight;
+	const unsigned int outputWidth = width * letterWidth;
+
+	STATS(StatsTimer timer("match");)
+	const Palette &palette = getPalette();
+	results.resize(width * height);
+
+	// Each letter is tested as normal, bold, underlined and bold underlined
+	// Every pixel of a letter is alpha * fg + (1 - alpha) * bg, which is how the letters are rendered
+	const unsigned int letterCount = settings.letterLimit && settings.letterLimit < font.letters1.size() ? settings.letterLimit : font.letters1.size();
+	const unsigned int variants = letterCount * 4;
+	const std::unique_ptr<float[]> alpha(new float[variants * letterArea]);
+	// The sums of (1 - alpha)^2, alpha * (1 - alpha) and alpha^2 for each variant
+	const std::unique_ptr<float[]> sums(new float[variants * 3]);
+	for (unsigned int v = 0; v < variants; v++) {
+		const bool bold = v & 1;
+		const bool underline = v & 2;
+		const float minc = bold ? font.min2 : font.min1;
+		const float maxc = bold ? font.max2 : font.max1;
+		const auto &letter = bold ? font.letters1b[v / 4] : font.letters1[v / 4];
+		const auto &underlineImage = bold ? font.underline1b : font.underline1;
+		float *a = &alpha[v * letterArea];
+		float s00 = 0, s01 = 0, s11 = 0;
+		for (unsigned int i = 0; i < letterArea; i++) {
+			unsigned char letterColor = letter[i];
+			if (underline) letterColor = std::max(letterColor, underlineImage[i * 3]);
+			a[i] = (letterColor - minc) / (maxc - minc);
+			s00 += (1.0f - a[i]) * (1.0f - a[i]);
+			s01 += a[i] * (1.0f - a[i]);
+			s11 += a[i] * a[i];
+		}
+		sums[v * 3    ] = s00;
+		sums[v * 3 + 1] = s01;
+		sums[v * 3 + 2] = s11;
+	}
+
+	// Go through the letter positions in the resulting image
+	for (unsigned int y2 = 0; y2 < height; y2++) {
+		if (settings.showProgress) std::cout << (y2 + 1) << " / " << height << "\r" << std::flush;
+
+		const unsigned int ys = y2 * letterHeight;
+
+		#pragma omp parallel for schedule(dynamic)
+		for (unsigned int x2 = 0; x2 < width; x2++) {
+
+			const unsigned int xs = x2 * letterWidth;
+			STATS(MatchCounters counters;)
+			STATS(const auto cellStart = std::chrono::high_resolution_clock::now();)
+
+			// Copy the current patch of the input image into separate color channels
+			const std::unique_ptr<float[]> patch(new float[letterArea * 3]);
+			float total[3] = {0, 0, 0};
+			double products[3][3] = {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}};
+			for (unsigned int y = 0; y < letterHeight; y++) {
+				for (unsigned int x = 0; x < letterWidth; x++) {
+					const unsigned char *pixel = &input[(xs + x + (ys + y) * outputWidth) * 3];
+					for (unsigned int i = 0; i < 3; i++) {
+						patch[x + y * letterWidth + i * letterArea] = pixel[i];
+						total[i] += pixel[i];
+						for (unsigned int j = 0; j < 3; j++) products[i][j] += pixel[i] * pixel[j];
+					}
+				}
+			}
+
+			double best = std::numeric_limits<double>::max();
+			auto &result = results[x2 + y2 * width];
+
+			for (unsigned int v = 0; v < variants; v++) {
+				STATS(counters.candidates++;)
+				STATS(counters.pixels += letterArea;)
+				const float *a = &alpha[v * letterArea];
+				const float s00 = sums[v * 3], s01 = sums[v * 3 + 1], s11 = sums[v * 3 + 2];
+				const float determinant = s00 * s11 - s01 * s01;
+
+				// The sums of alpha * input and (1 - alpha) * input for each channel
+				float fgSums[3], bgSums[3];
+				float fgColor[3], bgColor[3];
+				for (unsigned int i = 0; i < 3; i++) {
+					const float *channel = &patch[i * letterArea];
+					float sum = 0;
+					for (unsigned int j = 0; j < letterArea; j++) sum += a[j] * channel[j];
+					fgSums[i] = sum;
+					bgSums[i] = total[i] - sum;
+
+					// Letters such as space only have one color
+					if (determinant < 0.001f) {
+						fgColor[i] = bgColor[i] = total[i] / letterArea;
+					}
+					else {
+						fgColor[i] = (s00 * fgSums[i] - s01 * bgSums[i]) / determinant;
+						bgColor[i] = (s11 * bgSums[i] - s01 * fgSums[i]) / determinant;
+					}
+				}
+
+				int fgRGB[3], bgRGB[3];
+				const unsigned int fg = getNearestColor(fgColor, fgRGB, true);
+				const unsigned int bg = getNearestColor(bgColor, bgRGB, false);
+
+				// The squared error of the letter with the available colors
+				// The colors don't depend on the metric because it's the same for every pixel, but the error does
+				double error = 0;
+				for (unsigned int i = 0; i < 3; i++) {
+					for (unsigned int j = 0; j < 3; j++) {
+						if (!palette.metric[i][j]) continue;
+						error += palette.metric[i][j] * (products[i][j]
+							- bgRGB[j] * bgSums[i] - fgRGB[j] * fgSums[i] - bgRGB[i] * bgSums[j] - fgRGB[i] * fgSums[j]
+							+ (double)bgRGB[i] * bgRGB[j] * s00 + ((double)bgRGB[i] * fgRGB[j] + (double)fgRGB[i] * bgRGB[j]) * s01
+							+ (double)fgRGB[i] * fgRGB[j] * s11);
+					}
+				}
+
+				if (error < best) {
+					best = error;
+					result.c = v / 4;
+					result.fg = fg;
+					result.bg = bg;
+					result.bold = v & 1;
+					result.underline = (v & 2) != 0;
+				}
+			}
+
+			STATS(counters.cells++;)
+			STATS(stats.addCell(x2 + y2 * width, counters, cellStart);)
+		}
+	}
+}
@@ -0,0 +1,117 @@
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <limits>
+#include <cmath>
+#include "asciidrawer.hpp"
+#include "stats.hpp"
+
+#define M_PI_F 3.14159265358979323846f
+#define M_E_F 2.7182818284590452354f
+
+template <typename T, typename U, typename V> T clamp(const T v, const U lo, const V hi) {
+	return v < lo ? lo : (v > hi ? hi : v);
+}
+
+// Bicubic constant
+#define BCC -0.5f
+
+// Get the bicubic multiplier for upscaling purposes
+float getBicubicMult(const float x1, const float y1, const float x2, const float y2) {
+	const float dx = sqrt((x2 - x1) * (x2 - x1) + (y2 - y1) * (y2 - y1));
+	if (dx < 1.0f) return dx * dx * ((BCC + 2.0f) * dx - (BCC + 3.0f)) + 1.0f;
+	if (dx < 2.0f) return BCC * (dx * (dx * (dx - 5.0f) + 8.0f) - 4.0f);
+	return 0.0f;
+}
+
+// Upscaling using bicubic filtering
+unsigned char *scaleUp(const unsigned char *input, const unsigned int inputWidth, const unsigned int inputHeight,
+	const unsigned int outputWidth, const unsigned int outputHeight) {
+
+	STATS(StatsTimer timer("upscale");)
+	unsigned char *newInput = new unsigned char[outputWidth * outputHeight * 3];
+
+	// Go through scaled pixels
+	// The rows are split statically so that the same threads first touch and later match the same rows with NUMA_FIRST_TOUCH
+	#pragma omp parallel for schedule(static)
+	for (unsigned int y = 0; y < outputHeight; y++) {
+		for (unsigned int x = 0; x < outputWidth; x++) {
+			// x and y in the original image
+			const float xo = mix(0, outputWidth, 0, inputWidth, x);
+			const float yo = mix(0, outputHeight, 0, inputHeight, y);
+			float sum = 0, r = 0, g = 0, b = 0;
+			// Go through a 4 x 4 grid in the original image
+			for(int i = (int)xo - 1; i < (int)xo + 3; i++) {
+				for(int j = (int)yo - 1; j < (int)yo + 3; j++) {
+					const unsigned int pos = (clamp(j, 0, (int)inputHeight - 1) * inputWidth + clamp(i, 0, (int)inputWidth - 1)) * 3;
+					const float mult = getBicubicMult(xo, yo, i, j);
+					sum += mult;
+					r += input[pos    ] * mult;
+					g += input[pos + 1] * mult;
+					b += input[pos + 2] * mult;
+				}
+			}
+			const unsigned int pos = (x + y * outputWidth) * 3;
+			newInput[pos    ] = clamp(r / sum, 0, 255);
+			newInput[pos + 1] = clamp(g / sum, 0, 255);
+			newInput[pos + 2] = clamp(b / sum, 0, 255);
+		}
+	}
+
+	return newInput;
+}
+
+// Downscaling using gaussian blurring
+unsigned char *scaleDown(const unsigned char *input, const unsigned int inputWidth, const unsigned int inputHeight,
+	const unsigned int outputWidth, const unsigned int outputHeight) {
+
+	STATS(StatsTimer timer("downscale");)
+	const std::unique_ptr<unsigned char[]> temp(new unsigned char[outputWidth * inputHeight * 3]);
+	unsigned char *newInput = new unsigned char[outputWidth * outputHeight * 3];
+	const float gaussSizeX = (float)inputWidth / outputWidth;
+	const float gaussSizeY = (float)inputHeight / outputHeight;
+
+	// Scale down horizontally
+	#pragma omp parallel for
+	for (unsigned int y = 0; y < inputHeight; y++) {
+		for (int x = 0; x < (int)outputWidth; x++) {
+			const float origX = x * gaussSizeX + gaussSizeX * 0.5f;
+			float sum1 = 0, sum2 = 0, sum3 = 0;
+			float count = 0;
+			for (int x2 = std::max(0, int(origX - gaussSizeX)); x2 <= std::min(int(inputWidth - 1), int(ceil(origX + gaussSizeX))); x2++) {
+				const float mult = 1.0f / sqrt(2.0f * M_PI_F * gaussSizeX * gaussSizeX / 9.0f) * pow(M_E_F, -pow(abs(origX - x2), 2) / 2.0f / gaussSizeX / gaussSizeX * 9.0f);
+				count += mult;
+				sum1 += input[(y * inputWidth + x2) * 3    ] * mult;
+				sum2 += input[(y * inputWidth + x2) * 3 + 1] * mult;
+				sum3 += input[(y * inputWidth + x2) * 3 + 2] * mult;
+			}
+			temp[(y * outputWidth + x) * 3    ] = sum1 / count;
+			temp[(y * outputWidth + x) * 3 + 1] = sum2 / count;
+			temp[(y * outputWidth + x) * 3 + 2] = sum3 / count;
+		}
+	}
+
+	// Scale down vertically
+	// The rows are split statically so that the same threads first touch and later match the same rows with NUMA_FIRST_TOUCH
+	#pragma omp parallel for schedule(static)
+	for (int y = 0; y < (int)outputHeight; y++) {
+		const float origY = y * gaussSizeY + gaussSizeY * 0.5f;
+		for (unsigned int x = 0; x < outputWidth; x++) {
+			float sum1 = 0, sum2 = 0, sum3 = 0;
+			float count = 0;
+			for (int y2 = std::max(0, int(origY - gaussSizeY)); y2 <= std::min(int(inputHeight - 1), int(ceil(origY + gaussSizeY))); y2++) {
+				const float mult = 1.0f / sqrt(2.0f * M_PI_F * gaussSizeY * gaussSizeY / 9.0f) * pow(M_E_F, -pow(abs(origY - y2), 2) / 2.0f / gaussSizeY / gaussSizeY * 9.0f);
+				count += mult;
+				sum1 += temp[(y2 * outputWidth + x) * 3    ] * mult;
+				sum2 += temp[(y2 * outputWidth + x) * 3 + 1] * mult;
+				sum3 += temp[(y2 * outputWidth + x) * 3 + 2] * mult;
+			}
+			newInput[(y * outputWidth + x) * 3    ] = sum1 / count;
+			newInput[(y * outputWidth + x) * 3 + 1] = sum2 / count;
+			newInput[(y * outputWidth + x) * 3 + 2] = sum3 / count;
+		}
+	}
+
+	return newInput;
+}
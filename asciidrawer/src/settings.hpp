@@ -1,5 +1,14 @@
+#ifndef SETTINGS_HPP
+#define SETTINGS_HPP
+
 #define SHOW_RESULTS_IN_CONSOLE
 
+// Comment out to only output the results as text without creating the result image
+#define SAVE_RESULT_IMAGE "result.bmp"
+
+// Uncomment to also save the results as text with ANSI colors
+//#define SAVE_RESULT_TEXT "result.txt"
+
 // Width is in characters
 #define RESULT_WIDTH 200
 
@@ -8,16 +17,104 @@
 
 #define INPUT "example.bmp"
 
+// Uncomment to convert many images with the same font and threads instead of INPUT, see src/batch.hpp
+// BATCH is a directory whose bmp-files are converted into BATCH_OUTPUT with the same names
+// or a text file with an input path and optionally an output path on each line
+// BATCH_SIZE images are matched together, so larger values use the threads better but use more memory and every image
+// is saved only after all images of its batch are matched
+//#define BATCH "images"
+#define BATCH_OUTPUT "results"
+#define BATCH_SIZE 64
+
+// The server of "make server" listens to this Unix socket, see server/server.cpp
+// SERVER_WORKERS requests are converted at the same time and SERVER_QUEUE connections can wait for a worker,
+// the inputs can be at most SERVER_MAX_INPUT bytes and the results at most SERVER_MAX_LETTERS letters
+#define SERVER_SOCKET "/tmp/asciidrawer.sock"
+#define SERVER_WORKERS 4
+#define SERVER_QUEUE 64
+#define SERVER_MAX_INPUT 67108864
+#define SERVER_MAX_LETTERS 250000
+
+// Uncomment to create the results progressively, which first fills the image with solid colors and then refines the
+// letters with the largest errors first, saving the result image every PROGRESSIVE_INTERVAL milliseconds as a preview
+// The refining stops after PROGRESSIVE_TIME_LIMIT milliseconds with the best results so far, 0 refines all letters
+//#define PROGRESSIVE_INTERVAL 1000
+#define PROGRESSIVE_TIME_LIMIT 0
+
+// 0 = the 8 colors and their bold versions defined below
+// 1 = the xterm 256 color palette, where the first 16 colors are the colors defined below
+// 2 = 24-bit true colors
+// With 1 and 2 the colors are solved for each letter instead of testing all of them and QUALITY_THRESHOLD isn't used
+#define COLOR_MODE 0
+
+// Uncomment to compare colors by their luma and chroma instead of RGB, which is closer to how the colors are seen
+// The chroma differences are multiplied by CHROMA_WEIGHT, so values below 1 make the brightness more important
+//#define PERCEPTUAL_METRIC
+#define CHROMA_WEIGHT 0.5f
+
+// Uncomment to only use the half and quarter block letters, which are generated instead of loaded from the font images
+// This is meant for fast previews because the colors of each letter can be solved from the average colors of its quarters
+//#define BLOCK_MODE
+
+// Uncomment to solve the letter positions whose input is nearly a single color from the average color of the input
+// instead of testing the letters pixel by pixel, UNIFORM_VARIANCE is the largest variance of the colors that is allowed
+// With UNIFORM_DITHER the colors between the available colors are made by mixing two colors with a letter,
+// otherwise these letter positions become spaces with the closest background color
+//#define UNIFORM_VARIANCE 20
+#define UNIFORM_DITHER
+
+// Uncomment to first compare the letters to the input in blocks from the whole letter down to PYRAMID_BLOCK x PYRAMID_BLOCK pixels
+// This skips the letters that can't be better than the best letter so far without changing the results, which helps more
+// with large letters, but it is only used with the QUALITY_THRESHOLD 1 because lower thresholds can accept partial errors
+//#define PYRAMID_BLOCK 4
+
+// Uncomment to find the results approximately from a search tree of all letters, colors, bold and underline
+// Every combination is projected onto the TILE_INDEX_DIMENSIONS most important components of the letters for each color,
+// TILE_INDEX_CHECKS combinations are compared to the input in the search tree and the closest TILE_INDEX_CANDIDATES of them
+// are tested pixel by pixel, so more checks are slower but closer to testing all letters, QUALITY_THRESHOLD isn't used
+//#define TILE_INDEX_CHECKS 256
+#define TILE_INDEX_DIMENSIONS 8
+#define TILE_INDEX_CANDIDATES 16
+
+// Uncomment to keep the images near the threads that use them on computers with several NUMA nodes
+// The scaled input is first touched by the threads that then match the same rows of letters, which are split statically
+// between the threads instead of letter by letter, so this can be slower with a single NUMA node
+//#define NUMA_FIRST_TOUCH
+// Uncomment to pin every OpenMP thread to its own CPU, "spread" alternates between the NUMA nodes
+// and "close" fills one node before the next
+//#define PIN_THREADS "spread"
+
+// The maximum amount of rendered letters that are kept in memory for creating the result image
+#define TILE_CACHE_SIZE 100000
+
+// Uncomment to reuse the results of letter positions that have the same input as an earlier letter position
+// The lowest PATCH_CACHE_BITS bits of the colors are ignored, so higher values reuse more results with a lower quality
+// At most PATCH_CACHE_SIZE results are kept
+//#define PATCH_CACHE_SIZE 100000
+#define PATCH_CACHE_BITS 2
+
+// Uncomment to collect counters and timers of the matching and save them as JSON and in the Chrome trace event format
+//#define COLLECT_STATS
+#define STATS_JSON "stats.json"
+#define STATS_TRACE "trace.json"
+// Uncomment with COLLECT_STATS to also save the cost of matching every letter position as COST_MAP.csv
+// with the time and the counters of every letter position and as COST_MAP.bmp, which is a heatmap of the times
+//#define COST_MAP "result_cost"
+
+// The letters separated from the font images are cached into this file, which is mapped into memory on later runs
+// and created again when the font images or the settings below change, comment out to always load the font images
+#define FONT_ATLAS "font/font.atlas"
+
 #define UNDERLINE1 "font/underline.bmp"
 #define UNDERLINE1B "font/underline-bold.bmp"
 
 #define TEXT_AMOUNT 4 // the amount of font images defined below
 
 // Only one color channel is used, so the image should be gray scale
-const char *TEXT[TEXT_AMOUNT] = {
+const char *const TEXT[TEXT_AMOUNT] = {
 	"font/unicode-32-126.bmp", "font/unicode-161-255.bmp", "font/unicode-2404-2417.bmp", "font/unicode-2534-2554.bmp",
 };
-const char *TEXTB[TEXT_AMOUNT] = {
+const char *const TEXTB[TEXT_AMOUNT] = {
 	"font/unicode-32-126-bold.bmp", "font/unicode-161-255-bold.bmp", "font/unicode-2404-2417-bold.bmp", "font/unicode-2534-2554-bold.bmp",
 };
 // The Unicode index of the first character in the image
@@ -73,3 +170,5 @@ const unsigned char COLORS2[8][3] = {
 	{  0, 255, 255},
 	{255, 255, 255},
 };*/
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef STATS_HPP
+#define STATS_HPP
+
+#include "settings.hpp"
+
+// Everything inside STATS() is removed unless COLLECT_STATS is defined
+#ifdef COLLECT_STATS
+	#define STATS(...) __VA_ARGS__
+#else
+	#define STATS(...)
+#endif
+
+#ifdef COLLECT_STATS
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+
+// Counters of the matcher that are first collected separately for each letter position
+struct MatchCounters {
+	uint64_t cells, candidates, pixels, earlyExits, lookupHits, lookupMisses, cacheHits, cacheMisses, uniformCells, boundExits;
+	MatchCounters():
+		cells(0), candidates(0), pixels(0),
+		earlyExits(0), lookupHits(0), lookupMisses(0),
+		cacheHits(0), cacheMisses(0), uniformCells(0), boundExits(0) {}
+	void add(const MatchCounters &counters);
+};
+
+// The counters and the time of a single letter position, see COST_MAP
+struct CellCost {
+	MatchCounters counters;
+	float time; // microseconds
+	CellCost(): time(0) {}
+};
+
+class Stats {
+	public:
+		Stats(): frame(0), costWidth(0), costHeight(0), begin(std::chrono::high_resolution_clock::now()) {}
+		// The counters are added into a copy of the thread without locking and the copies are added together by endFrame
+		void addCounters(const MatchCounters &counters);
+		// Adds the counters of a single letter position, which are also kept in the cost map if it was started
+		void addCell(const unsigned int cell, const MatchCounters &counters, const std::chrono::high_resolution_clock::time_point &start);
+		// Keeps the costs of every letter position of the next image, the results are matched into it
+		// by their index so the cost map is only for a single image at a time
+		void startCostMap(const unsigned int width, const unsigned int height);
+		bool saveCostCSV(const char *filepath);
+		// Creates an image of the time of every letter position in the layout of the result image
+		unsigned char *createCostImage(const unsigned int letterWidth, const unsigned int letterHeight);
+		void addEvent(const char *name, const std::chrono::high_resolution_clock::time_point &start);
+		// Stores the counters of the current frame separately and starts a new frame
+		void endFrame();
+		bool saveJSON(const char *filepath);
+		bool saveTrace(const char *filepath);
+	private:
+		struct Event {
+			const char *name;
+			int64_t start, duration; // microseconds
+			unsigned int thread, frame;
+		};
+		struct ThreadCounters {
+			MatchCounters counters;
+			char padding[64]; // keeps the counters of the threads in separate cache lines
+		};
+		std::mutex mutex;
+		std::vector<std::unique_ptr<ThreadCounters>> threadCounters;
+		unsigned int frame;
+		MatchCounters total, current;
+		std::vector<MatchCounters> frames;
+		std::vector<Event> events;
+		unsigned int costWidth, costHeight;
+		std::vector<CellCost> costs;
+		const std::chrono::high_resolution_clock::time_point begin;
+};
+
+extern Stats stats;
+
+// Adds an event for the time between its construction and destruction
+class StatsTimer {
+	public:
+		StatsTimer(const char *name): name(name), start(std::chrono::high_resolution_clock::now()) {}
+		~StatsTimer() { stats.addEvent(name, start); }
+	private:
+		const char *name;
+		const std::chrono::high_resolution_clock::time_point start;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,102 @@
+#include "asciidrawer.hpp"
+#include "settings.hpp"
+#include "stats.hpp"
+
+inline UTF8Letter encodeUTF8(const unsigned int c) {
+	UTF8Letter letter;
+	if (c < 128) {
+		letter.bytes[0] = c;
+		letter.length = 1;
+	}
+	else if (c < 2048) {
+		letter.bytes[0] = 192 + (c >> 6);
+		letter.bytes[1] = 128 + (c & 63);
+		letter.length = 2;
+	}
+	else if (c < 65536) {
+		letter.bytes[0] = 224 + (c >> 12);
+		letter.bytes[1] = 128 + ((c >> 6) & 63);
+		letter.bytes[2] = 128 + (c & 63);
+		letter.length = 3;
+	}
+	else {
+		letter.bytes[0] = 240 + (c >> 18);
+		letter.bytes[1] = 128 + ((c >> 12) & 63);
+		letter.bytes[2] = 128 + ((c >> 6) & 63);
+		letter.bytes[3] = 128 + (c & 63);
+		letter.length = 4;
+	}
+	return letter;
+}
+
+// Create the UTF-8 encodings of all letters so that they don't have to be figured out for every printed letter
+std::vector<UTF8Letter> createUTF8Table() {
+	std::vector<UTF8Letter> utf8;
+	for (unsigned int t = 0; t < TEXT_AMOUNT; t++) {
+		for (unsigned int i = 0; i < TEXT_SIZE[t]; i++) utf8.push_back(encodeUTF8(TEXT_FIRST[t] + i));
+	}
+	#ifdef BLOCK_MODE
+		for (unsigned int i = 0; i < 16; i++) utf8.push_back(encodeUTF8(BLOCK_LETTERS[i]));
+	#endif
+	return utf8;
+}
+
+inline void appendNumber(std::string &buffer, const unsigned int value) {
+	if (value >= 100) buffer += char('0' + value / 100);
+	if (value >= 10) buffer += char('0' + value / 10 % 10);
+	buffer += char('0' + value % 10);
+}
+
+// Foreground colors start from 30 and background colors from 40
+inline void appendColor(std::string &buffer, const unsigned int color, const unsigned int base) {
+	if (COLOR_MODE == 0) {
+		appendNumber(buffer, color + base);
+	}
+	else if (COLOR_MODE == 1) {
+		appendNumber(buffer, base + 8);
+		buffer += ";5;";
+		appendNumber(buffer, color);
+	}
+	else {
+		appendNumber(buffer, base + 8);
+		buffer += ";2;";
+		appendNumber(buffer, color >> 16);
+		buffer += ';';
+		appendNumber(buffer, color >> 8 & 255);
+		buffer += ';';
+		appendNumber(buffer, color & 255);
+	}
+}
+
+// Write the results as text with ANSI colors into the buffer
+// The escape sequence is only written when the style differs from the previous letter on the same line
+void writeANSI(std::string &buffer, const std::vector<UTF8Letter> &utf8, const std::vector<Result> &results,
+	const unsigned int width, const unsigned int height) {
+
+	STATS(StatsTimer timer("text");)
+	buffer.clear();
+	// Each letter takes at most 4 bytes and a full escape sequence is 14, 26 or 42 bytes depending on COLOR_MODE
+	buffer.reserve(height * (width * (COLOR_MODE == 0 ? 18 : COLOR_MODE == 1 ? 30 : 46) + 5));
+
+	for (unsigned int y = 0; y < height; y++) {
+		// The results are stored bottom row first
+		const Result *row = &results[(height - y - 1) * width];
+		const Result *prev = 0;
+		for (unsigned int x = 0; x < width; x++) {
+			const Result &result = row[x];
+			if (!prev || prev->fg != result.fg || prev->bg != result.bg || prev->bold != result.bold || prev->underline != result.underline) {
+				buffer += "\033[0;";
+				if (result.bold) buffer += "1;";
+				if (result.underline) buffer += "4;";
+				appendColor(buffer, result.fg, 30);
+				buffer += ';';
+				appendColor(buffer, result.bg, 40);
+				buffer += 'm';
+				prev = &result;
+			}
+			const UTF8Letter &letter = utf8[result.c];
+			buffer.append(letter.bytes, letter.length);
+		}
+		buffer += "\033[0m\n";
+	}
+}
@@ -0,0 +1,377 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#if defined(_OPENMP)
+	#include <omp.h>
+#endif
+#include "../src/asciidrawer.hpp"
+#include "../src/settings.hpp"
+
+/*
+	Measures every stage of the conversion separately and prints the results as JSON.
+	All stages use the settings in settings.hpp except for the ones that are given as arguments:
+
+	--inputs a.png,b.bmp    the images that are converted besides the two generated ones, the default is inputs/00000.png,
+	                        the benchmark fails if any of them can't be loaded so that the runs always cover the same inputs
+	--widths 80,240         result widths in letters
+	--thresholds 0.07,0.15  quality thresholds
+	--threads 1,4           thread counts, only used with OpenMP
+	--scaling 64            thread counts 1, 2, 4 and so on up to the given count for measuring how the threads scale,
+	                        the runs show the speedups of the match stage from a single thread
+	--pin spread            pins the threads to CPUs with "spread" or "close" for every thread count, see PIN_THREADS
+	--repeat 3              how many times each configuration is measured
+	--output file.json      where the JSON is written, the default is the standard output
+	--ann 64,256,1024       also match with the tile index with these TILE_INDEX_CHECKS and compare the results
+	                        to testing all letters exactly with the threshold 1, which is timed as match_exact
+*/
+
+unsigned char *loadPNG(const char *filename, unsigned int &width, unsigned int &height, unsigned int &_channels);
+bool savePNG(const unsigned char *data, const char* filename, const unsigned int width, const unsigned int height);
+
+#define BENCHMARK_PNG "benchmark.png"
+
+struct Input {
+	std::string name;
+	unsigned int width, height;
+	std::unique_ptr<unsigned char[]> data;
+	double loadTime;
+};
+
+// The results of the tile index compared to testing all letters exactly
+struct Accuracy {
+	unsigned int checks;
+	double sameResults; // the fraction of the letter positions with the same result
+	double error; // the mean squared error of the result image
+};
+
+struct Stage {
+	std::string name;
+	std::vector<double> times;
+};
+
+inline double getMilliseconds(const std::chrono::high_resolution_clock::time_point &start) {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start).count() / 1000000.0;
+}
+
+void addTime(std::vector<Stage> &stages, const std::string &name, const double time) {
+	for (auto &stage : stages) {
+		if (stage.name == name) {
+			stage.times.push_back(time);
+			return;
+		}
+	}
+	stages.push_back(Stage());
+	stages.back().name = name;
+	stages.back().times.push_back(time);
+}
+
+template <typename T> std::vector<T> parseList(const char *arg) {
+	std::vector<T> values;
+	std::stringstream stream(arg);
+	std::string value;
+	while (std::getline(stream, value, ',')) values.push_back(atof(value.c_str()));
+	return values;
+}
+
+std::vector<std::string> parseNames(const char *arg) {
+	std::vector<std::string> names;
+	std::stringstream stream(arg);
+	std::string name;
+	while (std::getline(stream, name, ',')) {
+		if (!name.empty()) names.push_back(name);
+	}
+	return names;
+}
+
+// Loads a bmp or png image by its extension, returns false if it couldn't be loaded
+bool loadInput(Input &input, const std::string &filepath) {
+	input.name = filepath;
+	unsigned int channels = 3;
+	const auto start = std::chrono::high_resolution_clock::now();
+	if (filepath.size() > 4 && filepath.compare(filepath.size() - 4, 4, ".bmp") == 0) {
+		input.data.reset(loadBMP(filepath.c_str(), input.width, input.height));
+	}
+	else input.data.reset(loadPNG(filepath.c_str(), input.width, input.height, channels));
+	input.loadTime = getMilliseconds(start);
+	return input.data && channels == 3;
+}
+
+// The mean squared error of the rendered results from the input
+double getError(const Font &font, const std::vector<Result> &results, const unsigned char *input,
+	const unsigned int width, const unsigned int height) {
+
+	const unsigned int size = width * font.letterWidth * height * font.letterHeight * 3;
+	const std::unique_ptr<unsigned char[]> image(new unsigned char[size]);
+	TileRenderer renderer(font);
+	renderer.render(results, width, 0, height, image.get());
+	double sum = 0;
+	for (unsigned int i = 0; i < size; i++) sum += (image[i] - input[i]) * (image[i] - input[i]);
+	return sum / size;
+}
+
+// Create a reproducible image with gradients and noise
+Input createSynthetic(const std::string &name, const unsigned int width, const unsigned int height, const unsigned int noise) {
+	Input input;
+	input.name = name;
+	input.width = width;
+	input.height = height;
+	input.data.reset(new unsigned char[width * height * 3]);
+	input.loadTime = 0;
+	unsigned int random = 12345;
+	for (unsigned int y = 0; y < height; y++) {
+		for (unsigned int x = 0; x < width; x++) {
+			for (unsigned int i = 0; i < 3; i++) {
+				random = random * 1103515245 + 12345;
+				const int gradient = i == 0 ? x * 255 / width : (i == 1 ? y * 255 / height : (x + y) * 255 / (width + height));
+				const int value = gradient + (noise ? int((random >> 16) % (noise * 2 + 1)) - int(noise) : 0);
+				input.data[(x + y * width) * 3 + i] = std::max(0, std::min(255, value));
+			}
+		}
+	}
+	return input;
+}
+
+int main(int argc, char **argv) {
+	std::vector<unsigned int> widths = {80, 240};
+	std::vector<float> thresholds = {0.07f, QUALITY_THRESHOLD};
+	std::vector<unsigned int> threads = {1};
+	#if defined(_OPENMP)
+		if (omp_get_max_threads() > 1) threads.push_back(omp_get_max_threads());
+	#endif
+	unsigned int repeat = 1;
+	const char *output = 0;
+	std::vector<unsigned int> annChecks;
+	const char *pin = 0;
+	std::vector<std::string> inputNames = {"inputs/00000.png"};
+
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (!strcmp(argv[i], "--inputs")) inputNames = parseNames(argv[i + 1]);
+		else if (!strcmp(argv[i], "--widths")) widths = parseList<unsigned int>(argv[i + 1]);
+		else if (!strcmp(argv[i], "--thresholds")) thresholds = parseList<float>(argv[i + 1]);
+		else if (!strcmp(argv[i], "--threads")) threads = parseList<unsigned int>(argv[i + 1]);
+		else if (!strcmp(argv[i], "--scaling")) {
+			threads.clear();
+			const unsigned int maxThreads = std::max(1, atoi(argv[i + 1]));
+			for (unsigned int count = 1; count < maxThreads; count *= 2) threads.push_back(count);
+			threads.push_back(maxThreads);
+		}
+		else if (!strcmp(argv[i], "--pin")) pin = argv[i + 1];
+		else if (!strcmp(argv[i], "--repeat")) repeat = std::max(1, atoi(argv[i + 1]));
+		else if (!strcmp(argv[i], "--output")) output = argv[i + 1];
+		else if (!strcmp(argv[i], "--ann")) annChecks = parseList<unsigned int>(argv[i + 1]);
+		else {
+			std::cerr << "Unknown argument " << argv[i] << std::endl;
+			return 1;
+		}
+	}
+
+	// Load the font
+	auto start = std::chrono::high_resolution_clock::now();
+	Font font;
+	if (!loadFont(font)) {
+		std::cerr << "Couldn't load the font" << std::endl;
+		return 1;
+	}
+	const double fontTime = getMilliseconds(start);
+
+	// The tile index doesn't depend on the input, so it's created once
+	std::unique_ptr<TileIndex> tileIndex;
+	double tileIndexTime = 0;
+	if (!annChecks.empty()) {
+		start = std::chrono::high_resolution_clock::now();
+		tileIndex.reset(new TileIndex(font, TILE_INDEX_DIMENSIONS, TILE_INDEX_CANDIDATES));
+		tileIndexTime = getMilliseconds(start);
+	}
+
+	// Load the inputs
+	std::vector<Input> inputs(inputNames.size());
+	for (unsigned int i = 0; i < inputNames.size(); i++) {
+		if (!loadInput(inputs[i], inputNames[i])) {
+			std::cerr << "Couldn't load the input " << inputNames[i] << std::endl;
+			return 1;
+		}
+	}
+	inputs.push_back(createSynthetic("synthetic-noise", 1280, 720, 40));
+	inputs.push_back(createSynthetic("synthetic-gradient", 1280, 720, 0));
+
+	std::stringstream json;
+	json << "{\n\t\"letter_width\": " << font.letterWidth << ",\n\t\"letter_height\": " << font.letterHeight
+		<< ",\n\t\"letters\": " << font.letters1.size() << ",\n\t\"font_load_ms\": " << fontTime
+		<< ",\n\t\"repeat\": " << repeat << ",\n\t\"inputs\": [";
+	for (unsigned int i = 0; i < inputs.size(); i++) json << (i ? ", " : "") << "\"" << inputs[i].name << "\"";
+	json << "]";
+	if (tileIndex) {
+		json << ",\n\t\"tile_index\": {\"build_ms\": " << tileIndexTime << ", \"tiles\": " << tileIndex->getSize()
+			<< ", \"dimensions\": " << TILE_INDEX_DIMENSIONS << ", \"candidates\": " << TILE_INDEX_CANDIDATES << "}";
+	}
+	const std::vector<std::vector<unsigned int>> nodes = getNumaNodes();
+	json << ",\n\t\"numa_nodes\": [";
+	for (unsigned int n = 0; n < nodes.size(); n++) {
+		json << (n ? ", " : "") << "[";
+		for (unsigned int i = 0; i < nodes[n].size(); i++) json << (i ? ", " : "") << nodes[n][i];
+		json << "]";
+	}
+	json << "],\n\t\"pin\": \"" << (pin ? pin : "") << "\"";
+	json << ",\n\t\"runs\": [";
+
+	const std::vector<UTF8Letter> utf8 = createUTF8Table();
+	bool firstRun = true;
+
+	for (const auto &input : inputs) {
+		for (const unsigned int width : widths) {
+			const unsigned int height = (font.letterWidth * input.height * width + (font.letterHeight * input.width - 1)) / font.letterHeight / input.width;
+			const unsigned int outputWidth = width * font.letterWidth;
+			const unsigned int outputHeight = height * font.letterHeight;
+
+			for (const float threshold : thresholds) {
+				double singleThreadMatch = 0;
+				for (const unsigned int threadCount : threads) {
+					#if defined(_OPENMP)
+						omp_set_num_threads(threadCount);
+					#endif
+					if (pin && !pinThreads(pin)) {
+						std::cerr << "Couldn't pin the threads with " << pin << std::endl;
+						return 1;
+					}
+					std::cerr << input.name << ", width " << width << ", threshold " << threshold << ", threads " << threadCount << std::endl;
+
+					std::vector<Stage> stages;
+					std::vector<Accuracy> accuracies;
+					for (unsigned int r = 0; r < repeat; r++) {
+						// Scaling
+						std::unique_ptr<unsigned char[]> scaled;
+						start = std::chrono::high_resolution_clock::now();
+						if (outputWidth > input.width || outputHeight > input.height) {
+							scaled.reset(scaleUp(input.data.get(), input.width, input.height, outputWidth, outputHeight));
+							addTime(stages, "upscale", getMilliseconds(start));
+						}
+						else if (outputWidth != input.width || outputHeight != input.height) {
+							scaled.reset(scaleDown(input.data.get(), input.width, input.height, outputWidth, outputHeight));
+							addTime(stages, "downscale", getMilliseconds(start));
+						}
+						else {
+							scaled.reset(new unsigned char[outputWidth * outputHeight * 3]);
+							memcpy(scaled.get(), input.data.get(), outputWidth * outputHeight * 3);
+						}
+
+						// Matching from scratch and again with the previous results like in videos
+						MatchSettings matchSettings;
+						matchSettings.threshold = threshold;
+						matchSettings.usePrevious = false;
+						matchSettings.showProgress = false;
+						std::vector<Result> results(width * height);
+						start = std::chrono::high_resolution_clock::now();
+						matchResults(font, scaled.get(), width, height, matchSettings, results);
+						addTime(stages, "match", getMilliseconds(start));
+
+						// Matching with the tile index, the accuracy is compared to the exact results of the first repeat
+						std::vector<Result> exactResults;
+						if (!r && !annChecks.empty()) {
+							MatchSettings exactSettings = matchSettings;
+							exactSettings.threshold = 1.0f;
+							exactResults.resize(width * height);
+							start = std::chrono::high_resolution_clock::now();
+							matchResults(font, scaled.get(), width, height, exactSettings, exactResults);
+							addTime(stages, "match_exact", getMilliseconds(start));
+						}
+						for (const unsigned int checks : annChecks) {
+							MatchSettings annSettings = matchSettings;
+							annSettings.tileIndex = tileIndex.get();
+							annSettings.tileChecks = checks;
+							std::vector<Result> annResults(width * height);
+							start = std::chrono::high_resolution_clock::now();
+							matchResults(font, scaled.get(), width, height, annSettings, annResults);
+							addTime(stages, "match_ann_" + std::to_string(checks), getMilliseconds(start));
+							if (r) continue;
+							Accuracy accuracy;
+							accuracy.checks = checks;
+							accuracy.sameResults = 0;
+							for (unsigned int i = 0; i < exactResults.size(); i++) accuracy.sameResults += exactResults[i] == annResults[i];
+							accuracy.sameResults /= exactResults.size();
+							accuracy.error = getError(font, annResults, scaled.get(), width, height);
+							accuracies.push_back(accuracy);
+						}
+						if (!r && !annChecks.empty()) {
+							Accuracy accuracy;
+							accuracy.checks = 0;
+							accuracy.sameResults = 1;
+							accuracy.error = getError(font, exactResults, scaled.get(), width, height);
+							accuracies.insert(accuracies.begin(), accuracy);
+						}
+
+						matchSettings.usePrevious = true;
+						start = std::chrono::high_resolution_clock::now();
+						matchResults(font, scaled.get(), width, height, matchSettings, results);
+						addTime(stages, "match_previous", getMilliseconds(start));
+
+						// Rendering with empty and filled tile caches
+						const std::unique_ptr<unsigned char[]> image(new unsigned char[outputWidth * outputHeight * 3]);
+						TileRenderer renderer(font);
+						start = std::chrono::high_resolution_clock::now();
+						renderer.render(results, width, 0, height, image.get());
+						addTime(stages, "render", getMilliseconds(start));
+						start = std::chrono::high_resolution_clock::now();
+						renderer.render(results, width, 0, height, image.get());
+						addTime(stages, "render_cached", getMilliseconds(start));
+
+						// Encoding
+						std::string text;
+						start = std::chrono::high_resolution_clock::now();
+						writeANSI(text, utf8, results, width, height);
+						addTime(stages, "encode_text", getMilliseconds(start));
+						start = std::chrono::high_resolution_clock::now();
+						savePNG(image.get(), BENCHMARK_PNG, outputWidth, outputHeight);
+						addTime(stages, "encode_png", getMilliseconds(start));
+						remove(BENCHMARK_PNG);
+					}
+
+					json << (firstRun ? "" : ",") << "\n\t\t{\n\t\t\t\"input\": \"" << input.name
+						<< "\",\n\t\t\t\"input_width\": " << input.width << ",\n\t\t\t\"input_height\": " << input.height
+						<< ",\n\t\t\t\"width\": " << width << ",\n\t\t\t\"height\": " << height
+						<< ",\n\t\t\t\"threshold\": " << threshold << ",\n\t\t\t\"threads\": " << threadCount
+						<< ",\n\t\t\t\"stages\": {\n\t\t\t\t\"load\": {\"min_ms\": " << input.loadTime << ", \"mean_ms\": " << input.loadTime << "}";
+					for (const auto &stage : stages) {
+						double sum = 0;
+						for (const double time : stage.times) sum += time;
+						json << ",\n\t\t\t\t\"" << stage.name << "\": {\"min_ms\": " << *std::min_element(stage.times.begin(), stage.times.end())
+							<< ", \"mean_ms\": " << sum / stage.times.size() << "}";
+					}
+					json << "\n\t\t\t}";
+					// The speedup and the parallel efficiency of the match stage from the single thread run
+					for (const auto &stage : stages) {
+						if (stage.name != "match") continue;
+						const double matchTime = *std::min_element(stage.times.begin(), stage.times.end());
+						if (threadCount == 1) singleThreadMatch = matchTime;
+						if (singleThreadMatch > 0 && matchTime > 0) {
+							json << ",\n\t\t\t\"match_speedup\": " << singleThreadMatch / matchTime
+								<< ",\n\t\t\t\"match_efficiency\": " << singleThreadMatch / matchTime / threadCount;
+						}
+					}
+					// checks 0 is testing all letters exactly
+					if (!accuracies.empty()) {
+						json << ",\n\t\t\t\"ann\": [";
+						for (unsigned int i = 0; i < accuracies.size(); i++) {
+							json << (i ? "," : "") << "\n\t\t\t\t{\"checks\": " << accuracies[i].checks
+								<< ", \"same_results\": " << accuracies[i].sameResults << ", \"mse\": " << accuracies[i].error << "}";
+						}
+						json << "\n\t\t\t]";
+					}
+					json << "\n\t\t}";
+					firstRun = false;
+				}
+			}
+		}
+	}
+	json << "\n\t]\n}\n";
+
+	if (output) std::ofstream(output) << json.str();
+	else std::cout << json.str();
+	return 0;
+}
@@ -0,0 +1,50 @@
+#include <iostream>
+#include <fstream>
+#include "../src/asciidrawer.hpp"
+
+/*
+	Converts the font images into embed/font.hpp and embed/font.cpp, which are compiled into the program
+	with "make EMBED_FONT=1" so that it doesn't need the font images. The letters are stored in the layout
+	of the font atlas, see font.cpp.
+*/
+
+#define EMBED_HEADER "embed/font.hpp"
+#define EMBED_SOURCE "embed/font.cpp"
+
+int main() {
+	Font font;
+	if (!loadFontImages(font)) {
+		std::cout << "Couldn't load the font" << std::endl;
+		return 1;
+	}
+	const unsigned int letterCount = font.letters1.size();
+	const unsigned int size = font.letterWidth * font.letterHeight * (letterCount * 2 + 6);
+
+	std::ofstream header(EMBED_HEADER);
+	header << "// Generated from the font images by embed/embed.cpp\n\n"
+		<< "#ifndef EMBEDDED_FONT_HPP\n#define EMBEDDED_FONT_HPP\n\n"
+		<< "constexpr unsigned int EMBEDDED_LETTER_WIDTH = " << font.letterWidth << ";\n"
+		<< "constexpr unsigned int EMBEDDED_LETTER_HEIGHT = " << font.letterHeight << ";\n"
+		<< "constexpr unsigned int EMBEDDED_LETTER_COUNT = " << letterCount << ";\n"
+		<< "constexpr unsigned char EMBEDDED_MIN1 = " << (int)font.min1 << ", EMBEDDED_MAX1 = " << (int)font.max1 << ";\n"
+		<< "constexpr unsigned char EMBEDDED_MIN2 = " << (int)font.min2 << ", EMBEDDED_MAX2 = " << (int)font.max2 << ";\n\n"
+		<< "extern const unsigned char EMBEDDED_LETTERS[" << size << "];\n\n"
+		<< "#endif\n";
+
+	std::ofstream source(EMBED_SOURCE);
+	source << "// Generated from the font images by embed/embed.cpp\n\n"
+		<< "#include \"font.hpp\"\n\n"
+		<< "const unsigned char EMBEDDED_LETTERS[" << size << "] = {";
+	const unsigned char *data = font.letters1[0];
+	for (unsigned int i = 0; i < size; i++) {
+		source << (i % 32 ? " " : "\n\t") << (int)data[i] << ",";
+	}
+	source << "\n};\n";
+
+	if (!header.good() || !source.good()) {
+		std::cout << "Couldn't write " << EMBED_HEADER << " and " << EMBED_SOURCE << std::endl;
+		return 1;
+	}
+	std::cout << "Embedded " << letterCount << " letters of " << font.letterWidth << " x " << font.letterHeight << std::endl;
+	return 0;
+}
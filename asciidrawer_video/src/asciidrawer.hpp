@@ -0,0 +1,238 @@
+#ifndef ASCIIDRAWER_HPP
+#define ASCIIDRAWER_HPP
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <utility>
+#include <cstdint>
+
+// This represents a single colored and styled letter
+class Result {
+	public:
+		unsigned char c;
+		// Indexes of COLORS or the 256 color palette, or 0xRRGGBB with true colors, see COLOR_MODE
+		unsigned int fg, bg;
+		bool bold, underline;
+		Result():
+			c(0), fg(0), bg(0),
+			bold(0), underline(0) {}
+		bool operator==(const Result &r) const {
+			return c == r.c && fg == r.fg && bg == r.bg && bold == r.bold && underline == r.underline;
+		}
+};
+
+// The letters separated from the font images
+struct Font {
+	unsigned int letterWidth, letterHeight;
+	std::vector<const unsigned char*> letters1, letters1b;
+	const unsigned char *underline1, *underline1b; // these are still RGB images
+	// The memory that the letters point to, which is allocated or a mapped font atlas
+	std::vector<std::shared_ptr<const unsigned char>> memory;
+	// The color ranges of the normal and bold letters
+	unsigned char min1, max1, min2, max2;
+	// The index of the first generated block letter with BLOCK_MODE
+	unsigned int firstBlock;
+};
+
+// Renders results by copying prerendered letters into the output image
+// The letters are rendered when they are needed for the first time
+class TileRenderer {
+	public:
+		TileRenderer(const Font &font): font(font) {}
+		void render(const std::vector<Result> &results, const unsigned int width,
+			const unsigned int firstRow, const unsigned int lastRow, unsigned char *output);
+		unsigned int getLetterWidth() const { return font.letterWidth; }
+		unsigned int getLetterHeight() const { return font.letterHeight; }
+	private:
+		const Font &font;
+		std::unordered_map<uint64_t, std::unique_ptr<unsigned char[]>> tiles;
+		std::vector<const unsigned char*> letterTiles;
+		std::vector<std::pair<const Result*, unsigned char*>> missing;
+		void renderTile(const Result &result, unsigned char *tile) const;
+};
+
+// The block letters of BLOCK_MODE where the bits of the index are the upper left, upper right,
+// lower left and lower right quarters from the lowest bit
+const unsigned int BLOCK_LETTERS[16] = {
+	0x0020, 0x2598, 0x259D, 0x2580, 0x2596, 0x258C, 0x259E, 0x259B,
+	0x2597, 0x259A, 0x2590, 0x259C, 0x2584, 0x2599, 0x259F, 0x2588,
+};
+
+// An input image that is already scaled to the size of its results, see matchBatch
+struct MatchJob {
+	const unsigned char *input;
+	unsigned int width, height; // in letters
+	std::vector<Result> *results;
+};
+
+class PatchCache;
+class TileIndex;
+
+// Runtime settings for finding the results
+struct MatchSettings {
+	float threshold; // see QUALITY_THRESHOLD
+	bool usePrevious; // test the current results first, which speeds up videos
+	bool showProgress;
+	unsigned int letterLimit; // only this many letters from the start of the font are tested, 0 tests all
+	PatchCache *patchCache; // reuses the results of earlier letter positions with the same input, 0 matches all of them
+	const TileIndex *tileIndex; // finds the results approximately, 0 tests all letters
+	unsigned int tileChecks; // how many results the tile index compares, more is slower but closer to testing all letters
+	MatchSettings():
+		threshold(1.0f), usePrevious(false),
+		showProgress(false), letterLimit(0), patchCache(0),
+		tileIndex(0), tileChecks(0) {}
+};
+
+/*
+	Remembers the results of input image patches so that letter positions with the same patch are only matched once.
+	The patches are compared by a hash of their colors without the lowest bits, so similar patches also share a result.
+	The result is matched from the colors with the lowest bits in the middle of their range instead of the patch itself,
+	so it only depends on the key and the results are the same no matter which patch or thread was first.
+	The cache can be used by several threads at once and kept between the frames of a video.
+	It is split into parts by the hash and each part is emptied when it gets too large.
+*/
+class PatchCache {
+	public:
+		PatchCache(const unsigned int maxSize, const unsigned int bits);
+		// The key also depends on the settings that change the results
+		uint64_t getKey(const unsigned char *input, const unsigned int inputWidth, const unsigned int xs, const unsigned int ys,
+			const unsigned int letterWidth, const unsigned int letterHeight, const MatchSettings &settings) const;
+		// Writes the colors of the patch that the results of the key are matched from into patch, 3 bytes per pixel
+		void quantize(const unsigned char *input, const unsigned int inputWidth, const unsigned int xs, const unsigned int ys,
+			const unsigned int letterWidth, const unsigned int letterHeight, unsigned char *patch) const;
+		bool find(const uint64_t key, Result &result);
+		void insert(const uint64_t key, const Result &result);
+		uint64_t getHits() const { return hits; }
+		uint64_t getMisses() const { return misses; }
+		void resetCounters() { hits = misses = 0; }
+	private:
+		static const unsigned int PARTS = 64;
+		struct Part {
+			std::mutex mutex;
+			std::unordered_map<uint64_t, Result> results;
+		};
+		Part parts[PARTS];
+		const unsigned int maxPartSize;
+		const unsigned char mask;
+		std::atomic<uint64_t> hits, misses;
+};
+
+struct MatchContext;
+
+/*
+	Creates the results in two steps so that a complete result is available at any time.
+	start() fills every letter position with a space of the closest background color and refine() then finds the
+	best letters for the positions in the order of their errors, largest first, until the time limit.
+	The input image must stay valid until the refining is done.
+*/
+class ProgressiveMatcher {
+	public:
+		ProgressiveMatcher(const Font &font);
+		~ProgressiveMatcher();
+		void start(const unsigned char *input, const unsigned int width, const unsigned int height, std::vector<Result> &results);
+		// timeLimit is in milliseconds, 0 refines all letter positions
+		// Returns true if there are still letter positions left to refine
+		bool refine(const MatchSettings &settings, const double timeLimit, std::vector<Result> &results);
+		unsigned int getRemaining() const { return order.size() - next; }
+	private:
+		const Font &font;
+		std::unique_ptr<MatchContext> context;
+		std::vector<unsigned int> order; // the letter positions from the largest error of start()
+		unsigned int next;
+};
+
+/*
+	A search tree of all combinations of letters, colors, bold and underline with the default colors.
+	The letters are projected onto their most important components, so every combination becomes a few values
+	for each color channel that are kept in a k-d tree. A search compares the projected input to at most `checks`
+	combinations and returns the closest ones, which the matcher then compares pixel by pixel.
+*/
+class TileIndex {
+	public:
+		TileIndex(const Font &font, const unsigned int dimensions, const unsigned int candidates);
+		// Finds the closest candidates for the letter position at xs, ys of the input image in the compared color space
+		void search(const unsigned char *input, const unsigned int inputWidth, const unsigned int xs, const unsigned int ys,
+			const unsigned int checks, std::vector<Result> &results) const;
+		unsigned int getSize() const { return tiles.size(); }
+	private:
+		struct Node {
+			int dimension; // -1 for leaves
+			float split;
+			unsigned int left, right; // the child nodes or the range of tiles in leaves
+		};
+		const unsigned int letterWidth, letterHeight;
+		const unsigned int dimensions, candidates;
+		std::vector<float> basis; // the components of the letters, dimensions * letter area
+		std::vector<float> points; // the projected tiles, dimensions * 3 values each
+		std::vector<Result> tiles;
+		std::vector<Node> nodes;
+		unsigned int build(std::vector<unsigned int> &order, const unsigned int first, const unsigned int count);
+};
+
+// Returns values linearly from y1 to y2 when x has values from x1 to x2
+inline float mix(const float x1, const float x2, const float y1, const float y2, const float x) {
+	return (y1 - y2) * (x - x1) / (x1 - x2) + y1;
+}
+
+// Returns the color of a letter pixel with the value letterColor from the range minc-maxc of the letter images
+// This is rounded down in integers so that the matching and the rendering give the same colors everywhere
+inline unsigned char blendColor(const int minc, const int maxc, const int bg, const int fg, const int letterColor) {
+	if (maxc <= minc) return fg;
+	return (bg * (maxc - letterColor) + fg * (letterColor - minc)) / (maxc - minc);
+}
+
+// The UTF-8 bytes of a single letter
+struct UTF8Letter {
+	char bytes[4];
+	unsigned char length;
+};
+
+// blocks.cpp
+void addBlockLetters(Font &font);
+void solveBlocks(const Font &font, const unsigned char *input, const unsigned int width, const unsigned int height,
+	const MatchSettings &settings, std::vector<Result> &results);
+
+// bmp.cpp
+unsigned char *loadBMP(const char *filepath, unsigned int &width, unsigned int &height);
+unsigned char *decodeBMP(const unsigned char *data, const unsigned int size, const char *name, unsigned int &width, unsigned int &height);
+bool saveBMP(const unsigned char *data, const char *filepath, const unsigned int width, const unsigned int height);
+void encodeBMP(const unsigned char *data, const unsigned int width, const unsigned int height, std::string &output);
+
+// font.cpp
+bool loadFont(Font &font);
+bool loadFontImages(Font &font);
+
+// match.cpp
+void matchResults(const Font &font, const unsigned char *input, const unsigned int width, const unsigned int height,
+	const MatchSettings &settings, std::vector<Result> &results);
+void matchBatch(const Font &font, const std::vector<MatchJob> &jobs, const MatchSettings &settings);
+
+// numa.cpp
+std::vector<std::vector<unsigned int>> getNumaNodes();
+bool pinThreads(const char *policy);
+
+// palette.cpp
+void convertPerceptual(const unsigned char *input, unsigned char *output, const unsigned int pixels);
+void getMatchColors(unsigned char (*colors)[3]);
+void getResultColors(const Result &result, unsigned char *fg, unsigned char *bg);
+float getColorDistance(const float *color1, const float *color2);
+unsigned int getNearestColor(const float *color, int *rgb, const bool foreground);
+void solveResults(const Font &font, const unsigned char *input, const unsigned int width, const unsigned int height,
+	const MatchSettings &settings, std::vector<Result> &results);
+
+// scale.cpp
+unsigned char *scaleUp(const unsigned char *input, const unsigned int inputWidth, const unsigned int inputHeight,
+	const unsigned int outputWidth, const unsigned int outputHeight);
+unsigned char *scaleDown(const unsigned char *input, const unsigned int inputWidth, const unsigned int inputHeight,
+	const unsigned int outputWidth, const unsigned int outputHeight);
+
+// text.cpp
+std::vector<UTF8Letter> createUTF8Table();
+void writeANSI(std::string &buffer, const std::vector<UTF8Letter> &utf8, const std::vector<Result> &results,
+	const unsigned int width, const unsigned int height);
+
+#endif
@@ -0,0 +1,142 @@
+#include <iostream>
+#include <limits>
+#include "asciidrawer.hpp"
+#include "settings.hpp"
+#include "stats.hpp"
+
+// Returns the quarter that the letter pixel is in, see BLOCK_LETTERS
+// The letters are stored bottom row first like the images
+inline unsigned int getQuarter(const Font &font, const unsigned int x, const unsigned int y) {
+	const bool right = x >= font.letterWidth / 2; // see halfWidth
+	const bool lower = y < font.letterHeight / 2;
+	return right + lower * 2;
+}
+
+// Generate the block letters after the letters of the font images
+void addBlockLetters(Font &font) {
+	const unsigned int letterArea = font.letterWidth * font.letterHeight;
+	font.firstBlock = font.letters1.size();
+	unsigned char *data = new unsigned char[letterArea * 32];
+	font.memory.push_back(std::shared_ptr<const unsigned char>(data, std::default_delete<unsigned char[]>()));
+	for (unsigned int block = 0; block < 16; block++) {
+		unsigned char *letter = &data[block * 2 * letterArea];
+		unsigned char *letterb = letter + letterArea;
+		for (unsigned int y = 0; y < font.letterHeight; y++) {
+			for (unsigned int x = 0; x < font.letterWidth; x++) {
+				const bool filled = block & (1 << getQuarter(font, x, y));
+				letter[x + y * font.letterWidth] = filled ? font.max1 : font.min1;
+				letterb[x + y * font.letterWidth] = filled ? font.max2 : font.min2;
+			}
+		}
+		font.letters1.push_back(letter);
+		font.letters1b.push_back(letterb);
+	}
+}
+
+// Find the best matching block letters for the input image
+// The error of a block letter only depends on the average colors of its filled and empty quarters of the input image patch,
+// so the best colors for every block letter are the available colors closest to those averages
+void solveBlocks(const Font &font, const unsigned char *input, const unsigned int width, const unsigned int height,
+	const MatchSettings &settings, std::vector<Result> &results) {
+
+	const unsigned int letterWidth = font.letterWidth;
+	const unsigned int letterHeight = font.letterHeight;
+	const unsigned int outputWidth = width * letterWidth;
+
+	STATS(StatsTimer timer("match");)
+	results.resize(width * height);
+
+	// The amount of pixels in each quarter
+	const unsigned int halfWidth = letterWidth / 2;
+	unsigned int counts[4] = {0, 0, 0, 0};
+	for (unsigned int y = 0; y < letterHeight; y++) {
+		for (unsigned int x = 0; x < letterWidth; x++) counts[getQuarter(font, x, y)]++;
+	}
+
+	// The amount of pixels in every combination of quarters
+	unsigned int areas[16];
+	for (unsigned int region = 0; region < 16; region++) {
+		areas[region] = 0;
+		for (unsigned int quarter = 0; quarter < 4; quarter++) {
+			if (region & (1 << quarter)) areas[region] += counts[quarter];
+		}
+	}
+
+	// Go through the letter positions in the resulting image
+	for (unsigned int y2 = 0; y2 < height; y2++) {
+		if (settings.showProgress) std::cout << (y2 + 1) << " / " << height << "\r" << std::flush;
+
+		const unsigned int ys = y2 * letterHeight;
+
+		#pragma omp parallel for schedule(dynamic)
+		for (unsigned int x2 = 0; x2 < width; x2++) {
+
+			const unsigned int xs = x2 * letterWidth;
+			STATS(MatchCounters counters;)
+			STATS(const auto cellStart = std::chrono::high_resolution_clock::now();)
+
+			// Sum the colors of each quarter, the left and right halves of each row separately
+			unsigned int sums[4][3] = {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}};
+			for (unsigned int y = 0; y < letterHeight; y++) {
+				const unsigned char *pixel = &input[(xs + (ys + y) * outputWidth) * 3];
+				unsigned int *left = sums[getQuarter(font, 0, y)];
+				unsigned int *right = sums[getQuarter(font, letterWidth - 1, y)];
+				for (unsigned int x = 0; x < halfWidth * 3; x += 3) {
+					left[0] += pixel[x];
+					left[1] += pixel[x + 1];
+					left[2] += pixel[x + 2];
+				}
+				for (unsigned int x = halfWidth * 3; x < letterWidth * 3; x += 3) {
+					right[0] += pixel[x];
+					right[1] += pixel[x + 1];
+					right[2] += pixel[x + 2];
+				}
+			}
+			STATS(counters.pixels += letterWidth * letterHeight;)
+
+			// The closest foreground and background colors to the average color of every combination of quarters
+			// and their errors, which is all that changes between the colors
+			unsigned int fgColors[16], bgColors[16];
+			float fgErrors[16], bgErrors[16];
+			for (unsigned int region = 1; region < 16; region++) {
+				float average[3] = {0, 0, 0};
+				for (unsigned int quarter = 0; quarter < 4; quarter++) {
+					if (!(region & (1 << quarter))) continue;
+					for (unsigned int i = 0; i < 3; i++) average[i] += sums[quarter][i];
+				}
+				for (unsigned int i = 0; i < 3; i++) average[i] /= areas[region];
+
+				int fgRGB[3], bgRGB[3];
+				fgColors[region] = getNearestColor(average, fgRGB, true);
+				bgColors[region] = getNearestColor(average, bgRGB, false);
+				const float fgNearest[3] = {float(fgRGB[0]), float(fgRGB[1]), float(fgRGB[2])};
+				const float bgNearest[3] = {float(bgRGB[0]), float(bgRGB[1]), float(bgRGB[2])};
+				fgErrors[region] = getColorDistance(average, fgNearest) * areas[region];
+				bgErrors[region] = getColorDistance(average, bgNearest) * areas[region];
+			}
+			// Empty regions don't have any color
+			fgColors[0] = bgColors[0] = 0;
+			fgErrors[0] = bgErrors[0] = 0;
+
+			float best = std::numeric_limits<float>::max();
+			auto &result = results[x2 + y2 * width];
+
+			for (unsigned int block = 0; block < 16; block++) {
+				STATS(counters.candidates++;)
+				const float error = fgErrors[block] + bgErrors[15 - block];
+				if (error < best) {
+					best = error;
+					result.c = font.firstBlock + block;
+					// With the default colors the bold colors are returned as 8-15
+					result.fg = COLOR_MODE == 0 ? fgColors[block] & 7 : fgColors[block];
+					result.bg = bgColors[15 - block];
+					result.bold = COLOR_MODE == 0 && fgColors[block] >= 8;
+					result.underline = false;
+				}
+			}
+
+			STATS(counters.cells++;)
+			STATS(stats.addCell(x2 + y2 * width, counters, cellStart);)
+		}
+	}
+}
@@ -1,6 +1,9 @@
 #include <iostream>
 #include <fstream>
 #include <memory>
+#include <cstdint>
+#include <string>
+#include "asciidrawer.hpp"
 
 unsigned char *loadBMP(const char *filepath, unsigned int &width, unsigned int &height) {
 	std::ifstream file(filepath, std::ios::in | std::ios::binary | std::ios::ate);
@@ -14,6 +17,15 @@ unsigned char *loadBMP(const char *filepath, unsigned int &width, unsigned int &
 	const std::unique_ptr<unsigned char[]> data(new unsigned char[size]);
 	file.read((char*)data.get(), size);
 	file.close();
+	return decodeBMP(data.get(), size, filepath, width, height);
+}
+
+// Decode a bmp-file that is already in memory, name is used in the error messages
+unsigned char *decodeBMP(const unsigned char *data, const unsigned int size, const char *name, unsigned int &width, unsigned int &height) {
+	if (size < 54) {
+		std::cout << name << " isn't a bitmap" << std::endl;
+		return 0;
+	}
 
 	// Test compatibility
 	if (data[30]) {
@@ -29,13 +41,21 @@ unsigned char *loadBMP(const char *filepath, unsigned int &width, unsigned int &
 	// Dimensions
 	width = data[18] + (data[19] << 8) + (data[20] << 16) + (data[21] << 24);
 	height = data[22] + (data[23] << 8) + (data[24] << 16) + (data[25] << 24);
-	unsigned char *pixels = new unsigned char[width * height * 3];
 	// Calculate padding
 	unsigned int padding = 0;
 	if (bpp == 16 && width % 2) padding = 2;
 	if (bpp == 24 && width % 4) padding = 4 - (width * 3) % 4;
 	// Start of pixel data
 	unsigned int count = data[10] + (data[11] << 8) + (data[12] << 16) + (data[13] << 24);
+	if (!width || !height) {
+		std::cout << name << " doesn't have any pixels" << std::endl;
+		return 0;
+	}
+	if (count + ((uint64_t)width * bpp / 8 + padding) * height > (uint64_t)size) {
+		std::cout << name << " is too short for " << width << " x " << height << " pixels" << std::endl;
+		return 0;
+	}
+	unsigned char *pixels = new unsigned char[width * height * 3];
 
 	// Pixel data
 	for (unsigned int i = 0; i < height; i++) {
@@ -75,13 +95,8 @@ inline void updateHeader(char *headerPos, const unsigned int value) {
 	headerPos[3] = value >> 24;
 }
 
-bool saveBMP(const unsigned char *data, const char *filepath, const unsigned int width, const unsigned int height) {
-	std::ofstream file(filepath, std::ios::binary);
-	if (!file.good()) {
-		file.close();
-		return false;
-	}
-
+// Encode the image as a 24-bit bmp-file
+void encodeBMP(const unsigned char *data, const unsigned int width, const unsigned int height, std::string &output) {
 	// Create the header
 	char header[54] = {
 		66, 77,      // BM
@@ -101,27 +116,39 @@ bool saveBMP(const unsigned char *data, const char *filepath, const unsigned int
 	};
 
 	const unsigned char padding = width % 4;
-	const char *paddingArray = header + 50; // just use part of the header for writing padding (zeros) to the file
 
 	// Update the header
 	updateHeader(header + 2, width * height * 3 + padding * height + 54); // size of the file
 	updateHeader(header + 18, width); // width of the image
 	updateHeader(header + 22, height); // height of the image
 	updateHeader(header + 34, width * height * 3); // size of the pixel data
-	file.write(header, 54);
+	output.assign(header, 54);
 
-	// Save the pixel data
+	// Save the pixel data, the padding is zeros
+	output.resize(54 + (width * 3 + padding) * height);
+	char *outputPos = &output[54];
 	const unsigned char *dataPos = data;
 	for(unsigned int i = 0; i < height; i++) {
 		for(unsigned int j = 0; j < width; j++) {
-			file.put(dataPos[2]);
-			file.put(dataPos[1]);
-			file.put(dataPos[0]);
+			outputPos[0] = dataPos[2];
+			outputPos[1] = dataPos[1];
+			outputPos[2] = dataPos[0];
+			outputPos += 3;
 			dataPos += 3;
 		}
-		file.write(paddingArray, padding);
+		outputPos += padding;
 	}
+}
 
+bool saveBMP(const unsigned char *data, const char *filepath, const unsigned int width, const unsigned int height) {
+	std::ofstream file(filepath, std::ios::binary);
+	if (!file.good()) {
+		file.close();
+		return false;
+	}
+	std::string output;
+	encodeBMP(data, width, height, output);
+	file.write(output.data(), output.size());
 	file.close();
 	return true;
 }
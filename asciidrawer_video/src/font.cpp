@@ -0,0 +1,235 @@
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "asciidrawer.hpp"
+#include "settings.hpp"
+#include "stats.hpp"
+#ifdef EMBEDDED_FONT
+	#include "../embed/font.hpp"
+#endif
+
+// Increase this when the layout of the font atlas changes
+#define FONT_ATLAS_VERSION 1
+
+/*
+	The font atlas starts with this header after which the letters are stored in the same layout as in memory:
+	all normal letters, all bold letters and then the normal and bold underline RGB images.
+	The key is a hash of the font settings and the sizes and modification times of the font images,
+	so the atlas is created again when any of them change.
+	The underlined letters aren't stored because the matching merges the underline with a single max for each pixel,
+	which also tells when the underline doesn't change the pixel so the error without the underline can be reused.
+	The search tree of TILE_INDEX_CHECKS isn't stored either because it also depends on the colors
+	and the TILE_INDEX settings, and building it takes about 0.2 seconds once per run.
+*/
+struct FontAtlasHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t letterWidth, letterHeight, letterCount;
+	uint64_t key;
+	unsigned char min1, max1, min2, max2;
+};
+
+// Point the letters of the font to the data in the layout of the font atlas
+void setFontLetters(Font &font, const unsigned char *data, const unsigned int letterCount) {
+	const unsigned int letterArea = font.letterWidth * font.letterHeight;
+	font.letters1.resize(letterCount);
+	font.letters1b.resize(letterCount);
+	for (unsigned int i = 0; i < letterCount; i++) {
+		font.letters1[i] = &data[i * letterArea];
+		font.letters1b[i] = &data[(letterCount + i) * letterArea];
+	}
+	font.underline1 = &data[letterCount * 2 * letterArea];
+	font.underline1b = font.underline1 + letterArea * 3;
+}
+
+// FNV-1a
+inline void hashBytes(uint64_t &hash, const void *data, const unsigned int size) {
+	for (unsigned int i = 0; i < size; i++) {
+		hash = (hash ^ ((const unsigned char*)data)[i]) * 1099511628211ull;
+	}
+}
+
+inline void hashFile(uint64_t &hash, const char *filepath) {
+	hashBytes(hash, filepath, strlen(filepath) + 1);
+	struct stat info;
+	int64_t values[2] = {-1, -1};
+	if (!stat(filepath, &info)) {
+		values[0] = info.st_size;
+		values[1] = info.st_mtime;
+	}
+	hashBytes(hash, values, sizeof(values));
+}
+
+uint64_t getFontKey() {
+	uint64_t hash = 14695981039346656037ull;
+	const unsigned int version = FONT_ATLAS_VERSION;
+	hashBytes(hash, &version, sizeof(version));
+	hashFile(hash, UNDERLINE1);
+	hashFile(hash, UNDERLINE1B);
+	for (unsigned int t = 0; t < TEXT_AMOUNT; t++) {
+		hashFile(hash, TEXT[t]);
+		hashFile(hash, TEXTB[t]);
+		hashBytes(hash, &TEXT_FIRST[t], sizeof(TEXT_FIRST[t]));
+		hashBytes(hash, &TEXT_SIZE[t], sizeof(TEXT_SIZE[t]));
+	}
+	return hash;
+}
+
+// Map the font atlas into memory if it exists and matches the key
+bool loadFontAtlas(Font &font, const char *filepath, const uint64_t key) {
+	const int file = open(filepath, O_RDONLY);
+	if (file < 0) return false;
+	struct stat info;
+	void *mapping = fstat(file, &info) || (size_t)info.st_size < sizeof(FontAtlasHeader) ?
+		MAP_FAILED : mmap(0, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if (mapping == MAP_FAILED) return false;
+	const size_t size = info.st_size;
+	const std::shared_ptr<const unsigned char> memory((const unsigned char*)mapping,
+		[size](const unsigned char *data) { munmap((void*)data, size); });
+
+	const FontAtlasHeader &header = *(const FontAtlasHeader*)memory.get();
+	const size_t letterArea = header.letterWidth * header.letterHeight;
+	if (memcmp(header.magic, "ASCIIFNT", 8) || header.version != FONT_ATLAS_VERSION || header.key != key ||
+		size != sizeof(FontAtlasHeader) + letterArea * (header.letterCount * 2 + 6)) return false;
+
+	font.letterWidth = header.letterWidth;
+	font.letterHeight = header.letterHeight;
+	font.min1 = header.min1;
+	font.max1 = header.max1;
+	font.min2 = header.min2;
+	font.max2 = header.max2;
+	setFontLetters(font, memory.get() + sizeof(FontAtlasHeader), header.letterCount);
+	font.memory.assign(1, memory);
+	return true;
+}
+
+// The atlas is written into a temporary file first so that other processes never map a partial atlas
+bool saveFontAtlas(const Font &font, const char *filepath, const uint64_t key) {
+	FontAtlasHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "ASCIIFNT", 8);
+	header.version = FONT_ATLAS_VERSION;
+	header.letterWidth = font.letterWidth;
+	header.letterHeight = font.letterHeight;
+	header.letterCount = font.letters1.size();
+	header.key = key;
+	header.min1 = font.min1;
+	header.max1 = font.max1;
+	header.min2 = font.min2;
+	header.max2 = font.max2;
+	const size_t dataSize = font.letterWidth * font.letterHeight * (header.letterCount * 2 + 6);
+
+	const std::string temporary = std::string(filepath) + "." + std::to_string(getpid());
+	FILE *file = fopen(temporary.c_str(), "wb");
+	if (!file) return false;
+	const bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+		fwrite(font.memory[0].get(), 1, dataSize, file) == dataSize;
+	if (fclose(file) || !written || rename(temporary.c_str(), filepath)) {
+		remove(temporary.c_str());
+		return false;
+	}
+	return true;
+}
+
+// Load the font images and separate the letters from them
+bool loadFontImages(Font &font) {
+	// Load underline images
+	unsigned int width; // temp variable
+	unsigned int letterHeight;
+	const std::unique_ptr<unsigned char[]> underline1(loadBMP(UNDERLINE1, width, letterHeight));
+	const std::unique_ptr<unsigned char[]> underline1b(loadBMP(UNDERLINE1B, width, letterHeight));
+	if (!underline1 || !underline1b) return false;
+
+	const unsigned int letterWidth = width;
+	const unsigned int letterArea = letterWidth * letterHeight;
+	font.letterWidth = letterWidth;
+	font.letterHeight = letterHeight;
+
+	// All letters are stored in a single allocation in the layout of the font atlas
+	unsigned int letterCount = 0;
+	for (unsigned int t = 0; t < TEXT_AMOUNT; t++) letterCount += TEXT_SIZE[t];
+	unsigned char *memory = new unsigned char[letterArea * (letterCount * 2 + 6)];
+	font.memory.assign(1, std::shared_ptr<const unsigned char>(memory, std::default_delete<unsigned char[]>()));
+	setFontLetters(font, memory, letterCount);
+	memcpy(memory + letterCount * 2 * letterArea, underline1.get(), letterArea * 3);
+	memcpy(memory + (letterCount * 2 + 3) * letterArea, underline1b.get(), letterArea * 3);
+
+	// Separate letters from the images
+	unsigned char min1 = 255, max1 = 0;
+	unsigned char min2 = 255, max2 = 0;
+	unsigned int letter = 0;
+	for (unsigned int t = 0; t < TEXT_AMOUNT; t++) {
+		const std::unique_ptr<unsigned char[]> letterImg(loadBMP(TEXT[t], width, letterHeight));
+		const std::unique_ptr<unsigned char[]> letterbImg(loadBMP(TEXTB[t], width, letterHeight));
+		if (!letterImg || !letterbImg) return false;
+		for (unsigned int i = 0; i < TEXT_SIZE[t]; i++, letter++) {
+			unsigned char *data = memory + letter * letterArea;
+			unsigned char *data2 = memory + (letterCount + letter) * letterArea;
+			for (unsigned int y = 0; y < letterHeight; y++) {
+				for (unsigned int x = 0; x < letterWidth; x++) {
+					// Only one color channel is used, so the image should be gray scale
+					data[x + y * letterWidth] = letterImg[(x + i * letterWidth + y * width) * 3];
+					data2[x + y * letterWidth] = letterbImg[(x + i * letterWidth + y * width) * 3];
+					min1 = data[x + y * letterWidth] < min1 ? data[x + y * letterWidth] : min1;
+					max1 = data[x + y * letterWidth] > max1 ? data[x + y * letterWidth] : max1;
+					min2 = data2[x + y * letterWidth] < min2 ? data2[x + y * letterWidth] : min2;
+					max2 = data2[x + y * letterWidth] > max2 ? data2[x + y * letterWidth] : max2;
+				}
+			}
+		}
+	}
+
+	// Update the min and max values also from the underline images
+	for (unsigned int y = 0; y < letterHeight; y++) {
+		for (unsigned int x = 0; x < letterWidth; x++) {
+			// Only one color channel is used, so the image should be gray scale
+			min1 = underline1[(x + y * letterWidth) * 3] < min1 ? underline1[(x + y * letterWidth) * 3] : min1;
+			max1 = underline1[(x + y * letterWidth) * 3] > max1 ? underline1[(x + y * letterWidth) * 3] : max1;
+			min2 = underline1b[(x + y * letterWidth) * 3] < min2 ? underline1b[(x + y * letterWidth) * 3] : min2;
+			max2 = underline1b[(x + y * letterWidth) * 3] > max2 ? underline1b[(x + y * letterWidth) * 3] : max2;
+		}
+	}
+
+	font.min1 = min1;
+	font.max1 = max1;
+	font.min2 = min2;
+	font.max2 = max2;
+	return true;
+}
+
+// Load the font from the font atlas or from the font images, which also creates the font atlas
+bool loadFont(Font &font) {
+	STATS(StatsTimer timer("load_font");)
+	font.memory.clear();
+
+	// With "make EMBED_FONT=1" the letters are compiled into the program, see embed/embed.cpp
+	#ifdef EMBEDDED_FONT
+		font.letterWidth = EMBEDDED_LETTER_WIDTH;
+		font.letterHeight = EMBEDDED_LETTER_HEIGHT;
+		font.min1 = EMBEDDED_MIN1;
+		font.max1 = EMBEDDED_MAX1;
+		font.min2 = EMBEDDED_MIN2;
+		font.max2 = EMBEDDED_MAX2;
+		setFontLetters(font, EMBEDDED_LETTERS, EMBEDDED_LETTER_COUNT);
+	#elif defined(FONT_ATLAS)
+		const uint64_t key = getFontKey();
+		if (!loadFontAtlas(font, FONT_ATLAS, key)) {
+			if (!loadFontImages(font)) return false;
+			if (!saveFontAtlas(font, FONT_ATLAS, key)) std::cout << "Couldn't save the font atlas " << FONT_ATLAS << std::endl;
+		}
+	#else
+		if (!loadFontImages(font)) return false;
+	#endif
+
+	#ifdef BLOCK_MODE
+		addBlockLetters(font);
+	#endif
+	return true;
+}
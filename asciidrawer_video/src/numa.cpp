@@ -0,0 +1,103 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <sched.h>
+#include <dirent.h>
+#if defined(_OPENMP)
+	#include <omp.h>
+#endif
+#include "asciidrawer.hpp"
+
+// Parse a CPU list like "0-3,8-11"
+std::vector<unsigned int> parseCPUList(const char *list) {
+	std::vector<unsigned int> cpus;
+	while (*list) {
+		char *end;
+		const unsigned int first = strtoul(list, &end, 10);
+		if (end == list) break;
+		unsigned int last = first;
+		if (*end == '-') last = strtoul(end + 1, &end, 10);
+		for (unsigned int cpu = first; cpu <= last; cpu++) cpus.push_back(cpu);
+		list = *end == ',' ? end + 1 : end;
+	}
+	return cpus;
+}
+
+// Returns the CPUs of every NUMA node that the process is allowed to use
+std::vector<std::vector<unsigned int>> getNumaNodes() {
+	// The CPUs that the process was allowed to use before any of its threads were pinned
+	static const std::vector<unsigned int> allowed = []() {
+		std::vector<unsigned int> cpus;
+		cpu_set_t set;
+		if (!sched_getaffinity(0, sizeof(set), &set)) {
+			for (unsigned int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+				if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+			}
+		}
+		return cpus;
+	}();
+
+	std::vector<std::vector<unsigned int>> nodes;
+	if (DIR *directory = opendir("/sys/devices/system/node")) {
+		std::vector<unsigned int> numbers;
+		while (const dirent *entry = readdir(directory)) {
+			unsigned int number;
+			if (sscanf(entry->d_name, "node%u", &number) == 1) numbers.push_back(number);
+		}
+		closedir(directory);
+		std::sort(numbers.begin(), numbers.end());
+		for (const unsigned int number : numbers) {
+			char filepath[64], list[4096];
+			snprintf(filepath, sizeof(filepath), "/sys/devices/system/node/node%u/cpulist", number);
+			FILE *file = fopen(filepath, "r");
+			if (!file) continue;
+			const bool read = fgets(list, sizeof(list), file) != 0;
+			fclose(file);
+			if (!read) continue;
+			std::vector<unsigned int> cpus;
+			for (const unsigned int cpu : parseCPUList(list)) {
+				if (std::find(allowed.begin(), allowed.end(), cpu) != allowed.end()) cpus.push_back(cpu);
+			}
+			if (!cpus.empty()) nodes.push_back(cpus);
+		}
+	}
+
+	// Without the NUMA information all allowed CPUs are a single node
+	if (nodes.empty() && !allowed.empty()) nodes.push_back(allowed);
+	return nodes;
+}
+
+// Pins every OpenMP thread to its own CPU so that the threads stay near the memory that they first touched
+// "spread" alternates between the NUMA nodes and "close" fills one node before the next like OMP_PROC_BIND
+bool pinThreads(const char *policy) {
+	const std::vector<std::vector<unsigned int>> nodes = getNumaNodes();
+	if (nodes.empty()) return false;
+	std::vector<unsigned int> cpus;
+	if (!strcmp(policy, "spread")) {
+		// Take one CPU from every node in turn
+		for (unsigned int i = 0; cpus.size() < CPU_SETSIZE; i++) {
+			const unsigned int before = cpus.size();
+			for (const auto &node : nodes) {
+				if (i < node.size()) cpus.push_back(node[i]);
+			}
+			if (cpus.size() == before) break;
+		}
+	}
+	else if (!strcmp(policy, "close")) {
+		for (const auto &node : nodes) cpus.insert(cpus.end(), node.begin(), node.end());
+	}
+	else return false;
+
+	bool pinned = true;
+	#if defined(_OPENMP)
+		#pragma omp parallel reduction(&&: pinned)
+		{
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			CPU_SET(cpus[omp_get_thread_num() % cpus.size()], &set);
+			pinned = !sched_setaffinity(0, sizeof(set), &set);
+		}
+	#endif
+	return pinned;
+}
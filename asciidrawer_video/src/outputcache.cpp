@@ -0,0 +1,193 @@
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef __linux__
+	#include <linux/fs.h>
+#endif
+#include "outputcache.hpp"
+#include "settings.hpp"
+
+// FNV-1a
+inline void hashBytes(uint64_t &hash, const void *data, const size_t size) {
+	for (size_t i = 0; i < size; i++) {
+		hash = (hash ^ ((const unsigned char*)data)[i]) * 1099511628211ull;
+	}
+}
+
+// The frames are hashed 8 bytes at a time, the shift mixes the upper bits back into the lower bits
+inline void hashFrame(uint64_t &hash, const unsigned char *data, const size_t size) {
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8) {
+		uint64_t word;
+		memcpy(&word, &data[i], 8);
+		hash = (hash ^ word) * 1099511628211ull;
+		hash ^= hash >> 32;
+	}
+	hashBytes(hash, &data[i], size - i);
+}
+
+// Tries a reflink first, which shares the data on file systems that support it, and then copies the bytes
+bool copyFile(const char *from, const char *to) {
+	const int input = open(from, O_RDONLY);
+	if (input < 0) return false;
+	const int output = open(to, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (output < 0) {
+		close(input);
+		return false;
+	}
+	bool copied = false;
+	#ifdef FICLONE
+		copied = !ioctl(output, FICLONE, input);
+	#endif
+	if (!copied) {
+		char buffer[65536];
+		ssize_t size;
+		copied = true;
+		while (copied && (size = read(input, buffer, sizeof(buffer))) > 0) copied = write(output, buffer, size) == size;
+		copied = copied && !size;
+	}
+	close(input);
+	if (close(output) || !copied) {
+		unlink(to);
+		return false;
+	}
+	return true;
+}
+
+bool OutputCache::open(const char *directory, const Font &font) {
+	this->directory = directory;
+	if (mkdir(directory, 0755) && errno != EEXIST) return false;
+
+	settingsKey = 14695981039346656037ull;
+	const unsigned int values[4] = {OUTPUT_CACHE_VERSION, COLOR_MODE, font.letterWidth, font.letterHeight};
+	hashBytes(settingsKey, values, sizeof(values));
+	hashBytes(settingsKey, COLORS, sizeof(COLORS));
+	hashBytes(settingsKey, COLORS2, sizeof(COLORS2));
+	const unsigned int letterArea = font.letterWidth * font.letterHeight;
+	for (unsigned int c = 0; c < font.letters1.size(); c++) {
+		hashBytes(settingsKey, font.letters1[c], letterArea);
+		hashBytes(settingsKey, font.letters1b[c], letterArea);
+	}
+	hashBytes(settingsKey, font.underline1, letterArea * 3);
+	hashBytes(settingsKey, font.underline1b, letterArea * 3);
+	const unsigned char ranges[4] = {font.min1, font.max1, font.min2, font.max2};
+	hashBytes(settingsKey, ranges, sizeof(ranges));
+
+	// Every setting of the matching, also the ones that are only meant to make it faster like PYRAMID_BLOCK and
+	// PATCH_CACHE_SIZE so that changing them never returns results that were matched differently,
+	// only NUMA_FIRST_TOUCH and PIN_THREADS are left out because the results are the same with any threads
+	#ifdef BLOCK_MODE
+		hashBytes(settingsKey, "BLOCK_MODE", 10);
+	#endif
+	#ifdef PERCEPTUAL_METRIC
+		const float chromaWeight = CHROMA_WEIGHT;
+		hashBytes(settingsKey, "PERCEPTUAL_METRIC", 17);
+		hashBytes(settingsKey, &chromaWeight, sizeof(chromaWeight));
+	#endif
+	#ifdef UNIFORM_VARIANCE
+		const unsigned int variance = UNIFORM_VARIANCE;
+		hashBytes(settingsKey, "UNIFORM_VARIANCE", 16);
+		hashBytes(settingsKey, &variance, sizeof(variance));
+		#ifdef UNIFORM_DITHER
+			hashBytes(settingsKey, "UNIFORM_DITHER", 14);
+		#endif
+	#endif
+	#ifdef PYRAMID_BLOCK
+		const unsigned int pyramidBlock = PYRAMID_BLOCK;
+		hashBytes(settingsKey, "PYRAMID_BLOCK", 13);
+		hashBytes(settingsKey, &pyramidBlock, sizeof(pyramidBlock));
+	#endif
+	#ifdef TILE_INDEX_CHECKS
+		const unsigned int tileIndex[2] = {TILE_INDEX_DIMENSIONS, TILE_INDEX_CANDIDATES};
+		hashBytes(settingsKey, "TILE_INDEX", 10);
+		hashBytes(settingsKey, tileIndex, sizeof(tileIndex));
+	#endif
+	#ifdef PATCH_CACHE_SIZE
+		const unsigned int patchCache[2] = {PATCH_CACHE_SIZE, PATCH_CACHE_BITS};
+		hashBytes(settingsKey, "PATCH_CACHE", 11);
+		hashBytes(settingsKey, patchCache, sizeof(patchCache));
+	#endif
+	return true;
+}
+
+uint64_t OutputCache::getKey(const unsigned char *input, const unsigned int inputWidth, const unsigned int inputHeight,
+	const unsigned int width, const MatchSettings &settings) const {
+
+	uint64_t hash = settingsKey;
+	// The settings can change between the frames with TARGET_MATCH_TIME
+	uint32_t values[6] = {inputWidth, inputHeight, width, 0, settings.letterLimit, settings.tileChecks};
+	memcpy(&values[3], &settings.threshold, sizeof(float));
+	hashBytes(hash, values, sizeof(values));
+	hashFrame(hash, input, (size_t)inputWidth * inputHeight * 3);
+	return hash;
+}
+
+std::string OutputCache::getPath(const uint64_t key, const char *extension) const {
+	char name[32];
+	snprintf(name, sizeof(name), "/%016llx.%s", (unsigned long long)key, extension);
+	return directory + name;
+}
+
+bool OutputCache::find(const uint64_t key, const unsigned int width, const unsigned int height, std::vector<Result> &results) {
+	const size_t size = 12 + (size_t)width * height * 10;
+	FILE *file = fopen(getPath(key, "ascc").c_str(), "rb");
+	data.resize(size + 1);
+	const bool read = file && fread(data.data(), 1, data.size(), file) == size;
+	if (file) fclose(file);
+	const unsigned char *pos = data.data();
+	if (!read || memcmp(pos, "ASCC", 4) || pos[4] != OUTPUT_CACHE_VERSION || pos[5] || pos[6] != COLOR_MODE || pos[7] ||
+		(unsigned int)(pos[8] | pos[9] << 8) != width || (unsigned int)(pos[10] | pos[11] << 8) != height) {
+		misses++;
+		return false;
+	}
+
+	results.resize(width * height);
+	pos += 12;
+	for (Result &result : results) {
+		result.c = pos[0];
+		result.bold = (pos[1] >> 1) & 1;
+		result.underline = pos[1] & 1;
+		result.fg = pos[2] | pos[3] << 8 | pos[4] << 16 | (unsigned int)pos[5] << 24;
+		result.bg = pos[6] | pos[7] << 8 | pos[8] << 16 | (unsigned int)pos[9] << 24;
+		pos += 10;
+	}
+	hits++;
+	return true;
+}
+
+// The results are written into a temporary file first so that other runs never read a partial entry
+void OutputCache::store(const uint64_t key, const unsigned int width, const unsigned int height, const std::vector<Result> &results) {
+	data.assign({'A', 'S', 'C', 'C', OUTPUT_CACHE_VERSION, 0, COLOR_MODE, 0,
+		(unsigned char)width, (unsigned char)(width >> 8), (unsigned char)height, (unsigned char)(height >> 8)});
+	for (const Result &result : results) {
+		data.push_back(result.c);
+		data.push_back((result.bold << 1) | result.underline);
+		for (unsigned int i = 0; i < 4; i++) data.push_back(result.fg >> (i * 8));
+		for (unsigned int i = 0; i < 4; i++) data.push_back(result.bg >> (i * 8));
+	}
+
+	const std::string filepath = getPath(key, "ascc");
+	const std::string temporary = filepath + "." + std::to_string(getpid());
+	FILE *file = fopen(temporary.c_str(), "wb");
+	if (!file) return;
+	const bool written = fwrite(data.data(), 1, data.size(), file) == data.size();
+	if (fclose(file) || !written || rename(temporary.c_str(), filepath.c_str())) remove(temporary.c_str());
+}
+
+bool OutputCache::linkImage(const uint64_t key, const char *filepath) const {
+	unlink(filepath);
+	const std::string image = getPath(key, "png");
+	return !link(image.c_str(), filepath) || copyFile(image.c_str(), filepath);
+}
+
+void OutputCache::storeImage(const uint64_t key, const char *filepath) const {
+	const std::string image = getPath(key, "png");
+	if (!link(filepath, image.c_str()) || errno == EEXIST) return;
+	// The copy gets its final name only when it's complete
+	const std::string temporary = image + "." + std::to_string(getpid());
+	if (!copyFile(filepath, temporary.c_str()) || rename(temporary.c_str(), image.c_str())) remove(temporary.c_str());
+}
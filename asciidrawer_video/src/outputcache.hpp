@@ -0,0 +1,54 @@
+#ifndef OUTPUTCACHE_HPP
+#define OUTPUTCACHE_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "asciidrawer.hpp"
+
+/*
+	Remembers the results and the result images of the frames by a hash of the input frame and of everything
+	that changes its results: the result width, the match settings, the color mode, the colors, the letters of the font
+	and the settings of the optional matching paths.
+	Frames that were already converted by an earlier run or earlier in the same run then only cost the hash.
+
+	Every frame is stored in the cache directory as two files named by the key in hexadecimal:
+		<key>.ascc  the results, all values are little endian:
+			char[4]  "ASCC"
+			uint16   version
+			uint16   color mode, see COLOR_MODE
+			uint16   width and height in letters
+			for each letter: uint8 letter index, uint8 bold << 1 | underline, uint32 fg, uint32 bg
+		<key>.png   the result image, which is linked to the result images of the frames with the same key
+
+	The files are never changed after they are created, so the cache can be shared by several runs
+	and old entries can be removed by deleting the files.
+*/
+
+#define OUTPUT_CACHE_VERSION 2
+
+class OutputCache {
+	public:
+		OutputCache(): hits(0), misses(0) {}
+		// Creates the directory if it doesn't exist
+		bool open(const char *directory, const Font &font);
+		uint64_t getKey(const unsigned char *input, const unsigned int inputWidth, const unsigned int inputHeight,
+			const unsigned int width, const MatchSettings &settings) const;
+		bool find(const uint64_t key, const unsigned int width, const unsigned int height, std::vector<Result> &results);
+		void store(const uint64_t key, const unsigned int width, const unsigned int height, const std::vector<Result> &results);
+		// Links or copies the cached result image to filepath, returns false if it isn't cached
+		// The file at filepath is always removed first because it can be a link to an older entry of the cache
+		bool linkImage(const uint64_t key, const char *filepath) const;
+		// Adds the result image at filepath to the cache
+		void storeImage(const uint64_t key, const char *filepath) const;
+		uint64_t getHits() const { return hits; }
+		uint64_t getMisses() const { return misses; }
+	private:
+		std::string directory;
+		uint64_t settingsKey;
+		uint64_t hits, misses;
+		std::vector<unsigned char> data; // reused between frames
+		std::string getPath(const uint64_t key, const char *extension) const;
+};
+
+#endif
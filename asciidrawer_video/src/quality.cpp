@@ -0,0 +1,36 @@
+#include <cmath>
+#include <algorithm>
+#include "quality.hpp"
+
+// How much the level changes when the frame takes twice or half the target time
+#define QUALITY_GAIN 0.25f
+// The settings only use this many steps of the level, so frames matched at nearly the same level
+// get the same settings and can be found in the output cache
+#define QUALITY_LEVELS 16
+
+QualityController::QualityController(const double targetTime, const float minThreshold, const float maxThreshold,
+	const unsigned int minLetters, const unsigned int maxLetters):
+	targetTime(targetTime), minThreshold(minThreshold), maxThreshold(std::max(minThreshold, maxThreshold)),
+	minLetters(std::min(minLetters, maxLetters)), maxLetters(maxLetters), level(1.0f) {}
+
+void QualityController::update(const double matchTime, MatchSettings &settings) {
+	// The matching time is roughly proportional to the threshold and the amount of letters,
+	// so the level is changed by the logarithm of the ratio to react the same way to too slow and too fast frames
+	if (matchTime > 0) {
+		const float change = QUALITY_GAIN * std::log2(targetTime / matchTime);
+		level = std::min(std::max(level + change, 0.0f), 1.0f);
+	}
+	apply(settings);
+}
+
+void QualityController::apply(MatchSettings &settings) const {
+	const float step = std::round(level * QUALITY_LEVELS) / QUALITY_LEVELS;
+	if (step >= 0.5f) {
+		settings.threshold = minThreshold + (maxThreshold - minThreshold) * (step - 0.5f) * 2.0f;
+		settings.letterLimit = maxLetters;
+	}
+	else {
+		settings.threshold = minThreshold;
+		settings.letterLimit = minLetters + (unsigned int)((maxLetters - minLetters) * step * 2.0f);
+	}
+}
@@ -0,0 +1,28 @@
+#ifndef QUALITY_HPP
+#define QUALITY_HPP
+
+#include "asciidrawer.hpp"
+
+/*
+	Adjusts the match settings after every frame so that matching the next frame takes about the target time.
+	The quality level goes from 0 at the quality floor to 1 at the full quality. The upper half of the levels
+	lowers the quality threshold towards its minimum and the lower half also tests fewer letters, so the letters
+	are only reduced when the threshold alone isn't enough. The settings never go below the floor even if the
+	target time can't be reached. The settings follow the level in fixed steps so that they repeat between the frames.
+*/
+class QualityController {
+	public:
+		QualityController(const double targetTime, const float minThreshold, const float maxThreshold,
+			const unsigned int minLetters, const unsigned int maxLetters);
+		// matchTime is how long the previous frame took with the current settings in milliseconds
+		void update(const double matchTime, MatchSettings &settings);
+		void apply(MatchSettings &settings) const;
+		float getLevel() const { return level; }
+	private:
+		const double targetTime;
+		const float minThreshold, maxThreshold;
+		const unsigned int minLetters, maxLetters;
+		float level;
+};
+
+#endif
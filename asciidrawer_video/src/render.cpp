@@ -0,0 +1,75 @@
+#include <algorithm>
+#include <cstring>
+#include "asciidrawer.hpp"
+#include "settings.hpp"
+#include "stats.hpp"
+
+inline uint64_t getTileKey(const Result &result) {
+	return result.c | (uint64_t)result.bold << 8 | (uint64_t)result.underline << 9 |
+		(uint64_t)result.fg << 10 | (uint64_t)result.bg << 34;
+}
+
+// Render a single letter with its colors
+void TileRenderer::renderTile(const Result &result, unsigned char *tile) const {
+	const unsigned char minc = result.bold ? font.min2 : font.min1;
+	const unsigned char maxc = result.bold ? font.max2 : font.max1;
+	const auto &letter = result.bold ? font.letters1b[result.c] : font.letters1[result.c];
+	const auto &underline = result.bold ? font.underline1b : font.underline1;
+	unsigned char fg[3], bg[3];
+	getResultColors(result, fg, bg);
+
+	for (unsigned int letterPos = 0; letterPos < font.letterWidth * font.letterHeight; letterPos++) {
+		unsigned char letterColor = letter[letterPos];
+		if (result.underline) letterColor = std::max(letterColor, underline[letterPos * 3]);
+
+		tile[letterPos * 3    ] = blendColor(minc, maxc, bg[0], fg[0], letterColor);
+		tile[letterPos * 3 + 1] = blendColor(minc, maxc, bg[1], fg[1], letterColor);
+		tile[letterPos * 3 + 2] = blendColor(minc, maxc, bg[2], fg[2], letterColor);
+	}
+}
+
+// Render the result rows from firstRow to lastRow - 1 into output
+// The output only has to be large enough for the rendered rows and the first rendered row is placed at its beginning
+void TileRenderer::render(const std::vector<Result> &results, const unsigned int width,
+	const unsigned int firstRow, const unsigned int lastRow, unsigned char *output) {
+
+	STATS(StatsTimer timer("render");)
+	const unsigned int tileSize = font.letterWidth * font.letterHeight * 3;
+	const unsigned int rowSize = font.letterWidth * 3;
+	const unsigned int outputRowSize = width * rowSize;
+
+	// The rendered letters are kept between calls unless there are too many of them
+	if (tiles.size() > TILE_CACHE_SIZE) tiles.clear();
+
+	// Find the tiles of all letters and collect the ones that haven't been rendered yet
+	letterTiles.resize((lastRow - firstRow) * width);
+	missing.clear();
+	for (unsigned int i = 0; i < letterTiles.size(); i++) {
+		const Result &result = results[firstRow * width + i];
+		auto &tile = tiles[getTileKey(result)];
+		if (!tile) {
+			tile.reset(new unsigned char[tileSize]);
+			missing.push_back(std::make_pair(&result, tile.get()));
+		}
+		letterTiles[i] = tile.get();
+	}
+
+	#pragma omp parallel for
+	for (unsigned int i = 0; i < missing.size(); i++) {
+		renderTile(*missing[i].first, missing[i].second);
+	}
+
+	// Copy the tiles into the output row by row
+	#pragma omp parallel for
+	for (unsigned int y = 0; y < lastRow - firstRow; y++) {
+		unsigned char *rowOutput = output + y * font.letterHeight * outputRowSize;
+		const unsigned char *const *rowTiles = &letterTiles[y * width];
+		for (unsigned int y2 = 0; y2 < font.letterHeight; y2++) {
+			unsigned char *pos = rowOutput + y2 * outputRowSize;
+			for (unsigned int x = 0; x < width; x++) {
+				memcpy(pos, rowTiles[x] + y2 * rowSize, rowSize);
+				pos += rowSize;
+			}
+		}
+	}
+}
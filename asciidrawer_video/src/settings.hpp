@@ -1,19 +1,128 @@
+#ifndef SETTINGS_HPP
+#define SETTINGS_HPP
+
+// Comment out to only output the results as text without creating the result images
+#define SAVE_RESULT_IMAGE
+
+// Uncomment to also save the results as text with ANSI colors into the results-folder
+//#define SAVE_RESULT_TEXT
+
+// Uncomment to read the input frames from a video stream instead of the png-files in the inputs-folder
+// "-" is the standard input, for example: ffmpeg -i video.mp4 -f yuv4mpegpipe - | ./asciidrawer_video_linux
+// Y4M streams are detected from their header and anything else is read as raw rgb24 frames of the size below
+//#define INPUT_STREAM "-"
+#define INPUT_STREAM_WIDTH 1280
+#define INPUT_STREAM_HEIGHT 720
+
+// Uncomment to also write the result images into a video stream
+// "-" is the standard output, for example: ./asciidrawer_video_linux | ffmpeg -f yuv4mpegpipe -i - video.mp4
+// The other messages are then written into the standard error
+//#define OUTPUT_STREAM "-"
+#define OUTPUT_STREAM_Y4M // comment out to write raw rgb24 frames instead
+#define OUTPUT_STREAM_FPS 30
+
+// Uncomment to save the results of all frames into a single compact binary file
+// A keyframe is stored every STREAM_KEYFRAME_INTERVAL frames and other frames only store the changed letters
+//#define SAVE_RESULT_STREAM "results/results.ascv"
+#define STREAM_KEYFRAME_INTERVAL 100
+
+// Uncomment to keep the results and the result images of the frames in this folder by a hash of the input frame
+// and the settings, so later runs and repeated frames only hash the frames that were already converted
+// The frames are then matched without starting from the results of the previous frame, which is a bit slower
+// but makes the results of a frame the same no matter which frames were matched before it
+//#define OUTPUT_CACHE "cache"
+
+// Uncomment to only create the result images from a previously saved result stream
+//#define RENDER_RESULT_STREAM "results/results.ascv"
+
+// 0 = the 8 colors and their bold versions defined below
+// 1 = the xterm 256 color palette, where the first 16 colors are the colors defined below
+// 2 = 24-bit true colors
+// With 1 and 2 the colors are solved for each letter instead of testing all of them and QUALITY_THRESHOLD isn't used
+#define COLOR_MODE 0
+
+// Uncomment to compare colors by their luma and chroma instead of RGB, which is closer to how the colors are seen
+// The chroma differences are multiplied by CHROMA_WEIGHT, so values below 1 make the brightness more important
+//#define PERCEPTUAL_METRIC
+#define CHROMA_WEIGHT 0.5f
+
+// Uncomment to only use the half and quarter block letters, which are generated instead of loaded from the font images
+// This is meant for fast previews because the colors of each letter can be solved from the average colors of its quarters
+//#define BLOCK_MODE
+
+// Uncomment to solve the letter positions whose input is nearly a single color from the average color of the input
+// instead of testing the letters pixel by pixel, UNIFORM_VARIANCE is the largest variance of the colors that is allowed
+// With UNIFORM_DITHER the colors between the available colors are made by mixing two colors with a letter,
+// otherwise these letter positions become spaces with the closest background color
+//#define UNIFORM_VARIANCE 20
+#define UNIFORM_DITHER
+
+// Uncomment to first compare the letters to the input in blocks from the whole letter down to PYRAMID_BLOCK x PYRAMID_BLOCK pixels
+// This skips the letters that can't be better than the best letter so far without changing the results, which helps more
+// with large letters, but it is only used with the QUALITY_THRESHOLD 1 because lower thresholds can accept partial errors
+//#define PYRAMID_BLOCK 4
+
+// Uncomment to find the results approximately from a search tree of all letters, colors, bold and underline
+// Every combination is projected onto the TILE_INDEX_DIMENSIONS most important components of the letters for each color,
+// TILE_INDEX_CHECKS combinations are compared to the input in the search tree and the closest TILE_INDEX_CANDIDATES of them
+// are tested pixel by pixel, so more checks are slower but closer to testing all letters, QUALITY_THRESHOLD isn't used
+//#define TILE_INDEX_CHECKS 256
+#define TILE_INDEX_DIMENSIONS 8
+#define TILE_INDEX_CANDIDATES 16
+
+// Uncomment to keep the images near the threads that use them on computers with several NUMA nodes
+// The scaled input is first touched by the threads that then match the same rows of letters, which are split statically
+// between the threads instead of letter by letter, so this can be slower with a single NUMA node
+//#define NUMA_FIRST_TOUCH
+// Uncomment to pin every OpenMP thread to its own CPU, "spread" alternates between the NUMA nodes
+// and "close" fills one node before the next
+//#define PIN_THREADS "spread"
+
+// The maximum amount of rendered letters that are kept in memory for creating the result images
+#define TILE_CACHE_SIZE 100000
+
+// Uncomment to reuse the results of letter positions that have the same input as an earlier letter position
+// The lowest PATCH_CACHE_BITS bits of the colors are ignored, so higher values reuse more results with a lower quality
+// At most PATCH_CACHE_SIZE results are kept and kept between the frames
+//#define PATCH_CACHE_SIZE 100000
+#define PATCH_CACHE_BITS 2
+
+// Uncomment to collect counters and timers of the matching and save them as JSON and in the Chrome trace event format
+//#define COLLECT_STATS
+#define STATS_JSON "results/stats.json"
+#define STATS_TRACE "results/trace.json"
+// Uncomment with COLLECT_STATS to also save the cost of matching every letter position of each frame
+// as a CSV file with the time and the counters of every letter position and as a heatmap png of the times,
+// which are named like the result images with COST_MAP added to the name
+//#define COST_MAP "_cost"
+
+// Uncomment to adapt the quality of every frame so that matching it takes about this many milliseconds
+// The quality threshold is first lowered down to MIN_QUALITY_THRESHOLD and then fewer letters are tested
+// down to MIN_LETTERS, which is the quality floor that is kept even if the matching is still too slow
+//#define TARGET_MATCH_TIME 40
+#define MIN_QUALITY_THRESHOLD 0.01f
+#define MIN_LETTERS 95
+
 // Width is in characters
 #define RESULT_WIDTH 240
 
 // This can be from 0 to 1 - smaller values produce images faster but with lower quality
 #define QUALITY_THRESHOLD 0.07f
 
+// The letters separated from the font images are cached into this file, which is mapped into memory on later runs
+// and created again when the font images or the settings below change, comment out to always load the font images
+#define FONT_ATLAS "font/font.atlas"
+
 #define UNDERLINE1 "font/underline.bmp"
 #define UNDERLINE1B "font/underline-bold.bmp"
 
 #define TEXT_AMOUNT 2 // the amount of font images defined below
 
 // Only one color channel is used, so the image should be gray scale
-const char *TEXT[TEXT_AMOUNT] = {
+const char *const TEXT[TEXT_AMOUNT] = {
 	"font/unicode-32-126.bmp", "font/unicode-161-255.bmp",
 };
-const char *TEXTB[TEXT_AMOUNT] = {
+const char *const TEXTB[TEXT_AMOUNT] = {
 	"font/unicode-32-126-bold.bmp", "font/unicode-161-255-bold.bmp",
 };
 // The Unicode index of the first character in the image
@@ -69,3 +178,5 @@ const unsigned char COLORS2[8][3] = {
 	{  0, 255, 255},
 	{255, 255, 255},
 };*/
+
+#endif
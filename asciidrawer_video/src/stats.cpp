@@ -0,0 +1,194 @@
+#include "stats.hpp"
+
+#ifdef COLLECT_STATS
+
+#include <fstream>
+#include <map>
+#include <string>
+#include <algorithm>
+#if defined(_OPENMP)
+	#include <omp.h>
+#endif
+
+Stats stats;
+
+void MatchCounters::add(const MatchCounters &counters) {
+	cells += counters.cells;
+	candidates += counters.candidates;
+	pixels += counters.pixels;
+	earlyExits += counters.earlyExits;
+	lookupHits += counters.lookupHits;
+	lookupMisses += counters.lookupMisses;
+	cacheHits += counters.cacheHits;
+	cacheMisses += counters.cacheMisses;
+	uniformCells += counters.uniformCells;
+	boundExits += counters.boundExits;
+}
+
+void writeCounters(std::ofstream &file, const MatchCounters &counters) {
+	file << "{\"cells\": " << counters.cells << ", \"candidates\": " << counters.candidates
+		<< ", \"pixels\": " << counters.pixels << ", \"early_exits\": " << counters.earlyExits
+		<< ", \"lookup_hits\": " << counters.lookupHits << ", \"lookup_misses\": " << counters.lookupMisses
+		<< ", \"cache_hits\": " << counters.cacheHits << ", \"cache_misses\": " << counters.cacheMisses
+		<< ", \"uniform_cells\": " << counters.uniformCells
+		<< ", \"bound_exits\": " << counters.boundExits << "}";
+}
+
+void Stats::addCounters(const MatchCounters &counters) {
+	// The mutex is only needed when a thread adds its first counters
+	thread_local ThreadCounters *local = 0;
+	if (!local) {
+		std::lock_guard<std::mutex> lock(mutex);
+		threadCounters.emplace_back(new ThreadCounters());
+		local = threadCounters.back().get();
+	}
+	local->counters.add(counters);
+}
+
+void Stats::addCell(const unsigned int cell, const MatchCounters &counters, const std::chrono::high_resolution_clock::time_point &start) {
+	addCounters(counters);
+	// Every letter position is only matched by a single thread, so the costs don't need the mutex
+	if (cell < costs.size()) {
+		costs[cell].counters = counters;
+		costs[cell].time = std::chrono::duration<float, std::micro>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+}
+
+void Stats::startCostMap(const unsigned int width, const unsigned int height) {
+	costWidth = width;
+	costHeight = height;
+	costs.assign(width * height, CellCost());
+}
+
+// Save the costs of every letter position, the rows are from the top like in the result image
+bool Stats::saveCostCSV(const char *filepath) {
+	std::ofstream file(filepath);
+	if (!file.good()) return false;
+
+	file << "x,y,time_us,candidates,pixels,pixels_per_candidate,early_exits,bound_exits,uniform,cache_hit\n";
+	for (unsigned int y = 0; y < costHeight; y++) {
+		for (unsigned int x = 0; x < costWidth; x++) {
+			// The results are stored bottom row first
+			const CellCost &cost = costs[x + (costHeight - y - 1) * costWidth];
+			const MatchCounters &counters = cost.counters;
+			file << x << "," << y << "," << cost.time << "," << counters.candidates << "," << counters.pixels << ","
+				<< (counters.candidates ? double(counters.pixels) / counters.candidates : 0.0) << ","
+				<< counters.earlyExits << "," << counters.boundExits << ","
+				<< counters.uniformCells << "," << counters.cacheHits << "\n";
+		}
+	}
+	return file.good();
+}
+
+unsigned char *Stats::createCostImage(const unsigned int letterWidth, const unsigned int letterHeight) {
+	// The times are scaled by the 99th percentile so that a few interrupted letter positions don't hide the rest
+	std::vector<float> times(costs.size());
+	for (unsigned int i = 0; i < costs.size(); i++) times[i] = costs[i].time;
+	float scale = 0;
+	if (!times.empty()) {
+		std::nth_element(times.begin(), times.begin() + times.size() * 99 / 100, times.end());
+		scale = times[times.size() * 99 / 100];
+	}
+
+	// From black through red and yellow to white
+	const unsigned int outputWidth = costWidth * letterWidth;
+	unsigned char *output = new unsigned char[outputWidth * costHeight * letterHeight * 3];
+	for (unsigned int y2 = 0; y2 < costHeight; y2++) {
+		for (unsigned int x2 = 0; x2 < costWidth; x2++) {
+			const float value = scale > 0 ? std::min(costs[x2 + y2 * costWidth].time / scale, 1.0f) * 3 : 0;
+			unsigned char color[3];
+			for (unsigned int i = 0; i < 3; i++) color[i] = std::min(std::max(value - i, 0.0f), 1.0f) * 255 + 0.5f;
+			for (unsigned int y = y2 * letterHeight; y < (y2 + 1) * letterHeight; y++) {
+				unsigned char *pixel = &output[(x2 * letterWidth + y * outputWidth) * 3];
+				for (unsigned int x = 0; x < letterWidth * 3; x++) pixel[x] = color[x % 3];
+			}
+		}
+	}
+	return output;
+}
+
+void Stats::addEvent(const char *name, const std::chrono::high_resolution_clock::time_point &start) {
+	const auto end = std::chrono::high_resolution_clock::now();
+	Event event;
+	event.name = name;
+	event.start = std::chrono::duration_cast<std::chrono::microseconds>(start - begin).count();
+	event.duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+	#if defined(_OPENMP)
+		event.thread = omp_get_thread_num();
+	#else
+		event.thread = 0;
+	#endif
+	std::lock_guard<std::mutex> lock(mutex);
+	event.frame = frame;
+	events.push_back(event);
+}
+
+// The threads must not be matching anything at the same time
+void Stats::endFrame() {
+	std::lock_guard<std::mutex> lock(mutex);
+	for (auto &counters : threadCounters) {
+		current.add(counters->counters);
+		counters->counters = MatchCounters();
+	}
+	total.add(current);
+	frames.push_back(current);
+	current = MatchCounters();
+	frame++;
+}
+
+// Save the counters and the total time of each timer for every frame
+bool Stats::saveJSON(const char *filepath) {
+	std::lock_guard<std::mutex> lock(mutex);
+	std::ofstream file(filepath);
+	if (!file.good()) return false;
+
+	file << "{\n\t\"counters\": ";
+	writeCounters(file, total);
+	file << ",\n\t\"frames\": [";
+	for (unsigned int i = 0; i < frames.size(); i++) {
+		std::map<std::string, int64_t> timers;
+		for (const auto &event : events) {
+			if (event.frame == i) timers[event.name] += event.duration;
+		}
+		file << (i ? "," : "") << "\n\t\t{\"frame\": " << i << ", \"counters\": ";
+		writeCounters(file, frames[i]);
+		file << ", \"timers_ms\": {";
+		for (auto timer = timers.begin(); timer != timers.end(); timer++) {
+			file << (timer == timers.begin() ? "" : ", ") << "\"" << timer->first << "\": " << timer->second / 1000.0;
+		}
+		file << "}}";
+	}
+	file << "\n\t]\n}\n";
+	return file.good();
+}
+
+// Save the timers and the counters of each frame in the Chrome trace event format
+bool Stats::saveTrace(const char *filepath) {
+	std::lock_guard<std::mutex> lock(mutex);
+	std::ofstream file(filepath);
+	if (!file.good()) return false;
+
+	file << "{\"traceEvents\": [";
+	bool first = true;
+	for (const auto &event : events) {
+		file << (first ? "" : ",") << "\n{\"name\": \"" << event.name << "\", \"ph\": \"X\", \"ts\": " << event.start
+			<< ", \"dur\": " << event.duration << ", \"pid\": 1, \"tid\": " << event.thread
+			<< ", \"args\": {\"frame\": " << event.frame << "}}";
+		first = false;
+	}
+	// The counters are shown at the start of the first event of each frame
+	for (unsigned int i = 0; i < frames.size(); i++) {
+		for (const auto &event : events) {
+			if (event.frame != i) continue;
+			file << (first ? "" : ",") << "\n{\"name\": \"matcher\", \"ph\": \"C\", \"ts\": " << event.start << ", \"pid\": 1, \"args\": ";
+			writeCounters(file, frames[i]);
+			file << "}";
+			first = false;
+			break;
+		}
+	}
+	file << "\n]}\n";
+	return file.good();
+}
+
+#endif
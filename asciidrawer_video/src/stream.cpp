@@ -0,0 +1,238 @@
+#include <cstring>
+#include "stream.hpp"
+#include "settings.hpp"
+
+inline void putValue(unsigned char *pos, uint64_t value, const unsigned int bytes) {
+	for (unsigned int i = 0; i < bytes; i++) {
+		pos[i] = value & 0xff;
+		value >>= 8;
+	}
+}
+
+inline uint64_t getValue(const unsigned char *pos, const unsigned int bytes) {
+	uint64_t value = 0;
+	for (unsigned int i = bytes; i > 0; i--) value = (value << 8) | pos[i - 1];
+	return value;
+}
+
+inline void putVarint(std::vector<unsigned char> &data, unsigned int value) {
+	while (value >= 128) {
+		data.push_back(128 | (value & 127));
+		value >>= 7;
+	}
+	data.push_back(value);
+}
+
+inline unsigned int getVarint(const unsigned char *&pos, const unsigned char *end) {
+	unsigned int value = 0;
+	for (unsigned int shift = 0; pos < end && shift < 32; shift += 7) {
+		const unsigned char byte = *(pos++);
+		value |= (byte & 127) << shift;
+		if (!(byte & 128)) break;
+	}
+	return value;
+}
+
+// The size of a packed letter with each color mode
+const unsigned int CELL_SIZE[3] = {2, 4, 8};
+
+inline void putCell(std::vector<unsigned char> &data, const Result &result, const unsigned int colorMode) {
+	data.push_back(result.c);
+	if (colorMode == 0) {
+		data.push_back((result.fg << 5) | (result.bg << 2) | (result.bold << 1) | result.underline);
+		return;
+	}
+	data.push_back((result.bold << 1) | result.underline);
+	const unsigned int bytes = colorMode == 1 ? 1 : 3;
+	for (unsigned int i = bytes; i > 0; i--) data.push_back(result.fg >> ((i - 1) * 8));
+	for (unsigned int i = bytes; i > 0; i--) data.push_back(result.bg >> ((i - 1) * 8));
+}
+
+inline void getCell(const unsigned char *pos, Result &result, const unsigned int colorMode) {
+	result.c = pos[0];
+	result.bold = (pos[1] >> 1) & 1;
+	result.underline = pos[1] & 1;
+	if (colorMode == 0) {
+		result.fg = pos[1] >> 5;
+		result.bg = (pos[1] >> 2) & 7;
+		return;
+	}
+	const unsigned int bytes = colorMode == 1 ? 1 : 3;
+	result.fg = result.bg = 0;
+	for (unsigned int i = 0; i < bytes; i++) result.fg = (result.fg << 8) | pos[2 + i];
+	for (unsigned int i = 0; i < bytes; i++) result.bg = (result.bg << 8) | pos[2 + bytes + i];
+}
+
+bool ResultStreamWriter::open(const char *filepath, const unsigned int width, const unsigned int height,
+	const unsigned int letterWidth, const unsigned int letterHeight, const unsigned int keyframeInterval) {
+
+	close();
+	file.open(filepath, std::ios::binary);
+	if (!file.good()) return false;
+
+	this->width = width;
+	this->height = height;
+	this->keyframeInterval = keyframeInterval ? keyframeInterval : 1;
+	colorMode = COLOR_MODE;
+	previous.clear();
+	offsets.clear();
+	keyframes.clear();
+
+	unsigned char header[STREAM_HEADER_SIZE] = {'A', 'S', 'C', 'V'};
+	putValue(header + 4, STREAM_VERSION, 2);
+	putValue(header + 6, colorMode, 2);
+	putValue(header + 8, width, 2);
+	putValue(header + 10, height, 2);
+	putValue(header + 12, letterWidth, 2);
+	putValue(header + 14, letterHeight, 2);
+	// The frame count and the index offset are updated when closing the file
+	file.write((const char*)header, STREAM_HEADER_SIZE);
+	return file.good();
+}
+
+void ResultStreamWriter::write(const std::vector<Result> &results) {
+	if (!file.is_open() || results.size() != width * height) return;
+
+	const bool keyframe = previous.empty() || offsets.size() % keyframeInterval == 0;
+	payload.clear();
+
+	if (keyframe) {
+		for (unsigned int i = 0; i < results.size();) {
+			unsigned int run = 1;
+			while (i + run < results.size() && results[i + run] == results[i]) run++;
+			putVarint(payload, run);
+			putCell(payload, results[i], colorMode);
+			i += run;
+		}
+	}
+	else {
+		for (unsigned int i = 0; i < results.size();) {
+			unsigned int unchanged = 0;
+			while (i + unchanged < results.size() && results[i + unchanged] == previous[i + unchanged]) unchanged++;
+			unsigned int changed = 0;
+			while (i + unchanged + changed < results.size() && !(results[i + unchanged + changed] == previous[i + unchanged + changed])) changed++;
+			putVarint(payload, unchanged);
+			putVarint(payload, changed);
+			for (unsigned int j = i + unchanged; j < i + unchanged + changed; j++) putCell(payload, results[j], colorMode);
+			i += unchanged + changed;
+		}
+	}
+
+	offsets.push_back(file.tellp());
+	keyframes.push_back(keyframe);
+	unsigned char frameHeader[5];
+	frameHeader[0] = keyframe ? 0 : 1;
+	putValue(frameHeader + 1, payload.size(), 4);
+	file.write((const char*)frameHeader, 5);
+	file.write((const char*)payload.data(), payload.size());
+	previous = results;
+}
+
+void ResultStreamWriter::close() {
+	if (!file.is_open()) return;
+
+	// Write the frame index and update the header
+	const uint64_t indexOffset = file.tellp();
+	for (unsigned int i = 0; i < offsets.size(); i++) {
+		unsigned char entry[9];
+		putValue(entry, offsets[i], 8);
+		entry[8] = keyframes[i] ? 0 : 1;
+		file.write((const char*)entry, 9);
+	}
+	unsigned char values[12];
+	putValue(values, offsets.size(), 4);
+	putValue(values + 4, indexOffset, 8);
+	file.seekp(16);
+	file.write((const char*)values, 12);
+	file.close();
+}
+
+bool ResultStreamReader::open(const char *filepath) {
+	file.close();
+	file.clear();
+	file.open(filepath, std::ios::binary);
+	if (!file.good()) return false;
+
+	unsigned char header[STREAM_HEADER_SIZE];
+	if (!file.read((char*)header, STREAM_HEADER_SIZE) || memcmp(header, "ASCV", 4)) return false;
+	colorMode = getValue(header + 6, 2);
+	if (getValue(header + 4, 2) != STREAM_VERSION || colorMode > 2) return false;
+	width = getValue(header + 8, 2);
+	height = getValue(header + 10, 2);
+	letterWidth = getValue(header + 12, 2);
+	letterHeight = getValue(header + 14, 2);
+	const unsigned int frames = getValue(header + 16, 4);
+
+	// Load the frame index
+	std::vector<unsigned char> index(frames * 9);
+	file.seekg(getValue(header + 20, 8));
+	if (!file.read((char*)index.data(), index.size())) return false;
+	offsets.resize(frames);
+	keyframes.resize(frames);
+	for (unsigned int i = 0; i < frames; i++) {
+		offsets[i] = getValue(&index[i * 9], 8);
+		keyframes[i] = !index[i * 9 + 8];
+	}
+
+	current.assign(width * height, Result());
+	currentFrame = -1;
+	return true;
+}
+
+bool ResultStreamReader::read(const unsigned int frame, std::vector<Result> &results) {
+	if (frame >= offsets.size()) return false;
+
+	if ((int)frame != currentFrame) {
+		// Seek to the closest keyframe unless the frame can be decoded from the current one
+		unsigned int start = frame;
+		while (start > 0 && !keyframes[start] && (int)start != currentFrame + 1) start--;
+		for (unsigned int i = start; i <= frame; i++) {
+			if (!decode(i)) {
+				currentFrame = -1;
+				return false;
+			}
+		}
+	}
+
+	results = current;
+	return true;
+}
+
+bool ResultStreamReader::decode(const unsigned int frame) {
+	unsigned char frameHeader[5];
+	file.clear();
+	file.seekg(offsets[frame]);
+	if (!file.read((char*)frameHeader, 5)) return false;
+	payload.resize(getValue(frameHeader + 1, 4));
+	if (!file.read((char*)payload.data(), payload.size())) return false;
+
+	const unsigned char *pos = payload.data();
+	const unsigned char *end = pos + payload.size();
+	const unsigned int cellSize = CELL_SIZE[colorMode];
+	unsigned int i = 0;
+
+	if (!frameHeader[0]) {
+		while (pos < end && i < current.size()) {
+			const unsigned int run = getVarint(pos, end);
+			if (pos + cellSize > end || i + run > current.size()) return false;
+			getCell(pos, current[i], colorMode);
+			for (unsigned int j = i + 1; j < i + run; j++) current[j] = current[i];
+			pos += cellSize;
+			i += run;
+		}
+	}
+	else {
+		while (pos < end && i < current.size()) {
+			i += getVarint(pos, end);
+			const unsigned int changed = getVarint(pos, end);
+			if (pos + changed * cellSize > end || i + changed > current.size()) return false;
+			for (unsigned int j = 0; j < changed; j++) {
+				getCell(pos, current[i++], colorMode);
+				pos += cellSize;
+			}
+		}
+	}
+
+	currentFrame = frame;
+	return i == current.size();
+}
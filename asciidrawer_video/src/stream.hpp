@@ -0,0 +1,75 @@
+#ifndef STREAM_HPP
+#define STREAM_HPP
+
+#include <fstream>
+#include <vector>
+#include <cstdint>
+#include "asciidrawer.hpp"
+
+/*
+	Result stream file format, all values are little endian:
+
+	Header (32 bytes):
+		char[4]  "ASCV"
+		uint16   version
+		uint16   color mode, see COLOR_MODE
+		uint16   width and height in letters
+		uint16   letter width and height in pixels
+		uint32   frame count
+		uint64   offset of the frame index
+		uint32   reserved
+	Frames:
+		uint8    frame type (0 = keyframe, 1 = delta frame)
+		uint32   payload size in bytes
+		payload
+	Frame index (at the end of the file), for each frame:
+		uint64   offset of the frame
+		uint8    frame type
+
+	Each letter is packed into 2 bytes with color mode 0: the letter index and fg << 5 | bg << 2 | bold << 1 | underline.
+	With color mode 1 the letter takes 4 bytes: the letter index, bold << 1 | underline, fg and bg.
+	With color mode 2 the letter takes 8 bytes: the letter index, bold << 1 | underline, fg RGB and bg RGB.
+	Keyframe payloads are runs of identical letters: varint run length followed by a letter.
+	Delta frame payloads compare to the previous frame: varint amount of unchanged letters,
+	varint amount of changed letters and the changed letters. This repeats until the frame is covered.
+*/
+
+#define STREAM_VERSION 1
+#define STREAM_HEADER_SIZE 32
+
+class ResultStreamWriter {
+	public:
+		bool open(const char *filepath, const unsigned int width, const unsigned int height,
+			const unsigned int letterWidth, const unsigned int letterHeight, const unsigned int keyframeInterval);
+		void write(const std::vector<Result> &results);
+		void close();
+		~ResultStreamWriter() { close(); }
+	private:
+		std::ofstream file;
+		unsigned int width, height, keyframeInterval;
+		unsigned int colorMode;
+		std::vector<Result> previous;
+		std::vector<uint64_t> offsets;
+		std::vector<bool> keyframes;
+		std::vector<unsigned char> payload; // reused between frames
+};
+
+class ResultStreamReader {
+	public:
+		unsigned int width, height, letterWidth, letterHeight;
+		unsigned int colorMode;
+		bool open(const char *filepath);
+		unsigned int getFrameCount() const { return offsets.size(); }
+		// Decodes any frame starting from the closest keyframe if it isn't the next frame
+		bool read(const unsigned int frame, std::vector<Result> &results);
+	private:
+		std::ifstream file;
+		std::vector<uint64_t> offsets;
+		std::vector<bool> keyframes;
+		std::vector<Result> current;
+		int currentFrame;
+		std::vector<unsigned char> payload; // reused between frames
+		bool decode(const unsigned int frame);
+};
+
+#endif
@@ -0,0 +1,230 @@
+#include <cmath>
+#include <algorithm>
+#include <queue>
+#include <functional>
+#include "asciidrawer.hpp"
+#include "stats.hpp"
+
+// The largest amount of tiles in the leaves of the k-d tree
+#define TILE_LEAF_SIZE 8
+// The amount of power iterations for every component of the letters
+#define TILE_ITERATIONS 100
+
+TileIndex::TileIndex(const Font &font, const unsigned int dimensions, const unsigned int candidates):
+	letterWidth(font.letterWidth), letterHeight(font.letterHeight),
+	dimensions(std::min(std::max(dimensions, 1u), font.letterWidth * font.letterHeight)), candidates(std::max(candidates, 1u)) {
+
+	STATS(StatsTimer timer("tile_index");)
+	const unsigned int letterArea = letterWidth * letterHeight;
+	const unsigned int variants = font.letters1.size() * 4;
+
+	// The coverages from 0 at the background color to 1 at the foreground color of every letter, bold and underline
+	std::vector<float> coverages(variants * letterArea);
+	for (unsigned int c = 0; c < font.letters1.size(); c++) {
+		for (unsigned int bold = 0; bold < 2; bold++) {
+			const unsigned char *letter = bold ? font.letters1b[c] : font.letters1[c];
+			const unsigned char *underline = bold ? font.underline1b : font.underline1;
+			const float minc = bold ? font.min2 : font.min1;
+			const float range = (bold ? font.max2 : font.max1) - minc;
+			for (unsigned int letterPos = 0; letterPos < letterArea; letterPos++) {
+				float *coverage = &coverages[(c * 4 + bold * 2) * letterArea + letterPos];
+				coverage[0] = range > 0 ? (letter[letterPos] - minc) / range : 1;
+				coverage[letterArea] = range > 0 ? (std::max(letter[letterPos], underline[letterPos * 3]) - minc) / range : 1;
+			}
+		}
+	}
+
+	// The first component is the average of the pixels and the rest are the principal components
+	// of the letters without their averages, which are found by power iteration
+	std::vector<double> covariances(letterArea * letterArea, 0.0);
+	std::vector<double> centered(letterArea);
+	for (unsigned int v = 0; v < variants; v++) {
+		const float *coverage = &coverages[v * letterArea];
+		double mean = 0;
+		for (unsigned int p = 0; p < letterArea; p++) mean += coverage[p];
+		mean /= letterArea;
+		for (unsigned int p = 0; p < letterArea; p++) centered[p] = coverage[p] - mean;
+		for (unsigned int p = 0; p < letterArea; p++) {
+			for (unsigned int q = 0; q < letterArea; q++) covariances[p * letterArea + q] += centered[p] * centered[q];
+		}
+	}
+	basis.assign(this->dimensions * letterArea, 0.0f);
+	for (unsigned int p = 0; p < letterArea; p++) basis[p] = 1.0f / std::sqrt(float(letterArea));
+	std::vector<double> component(letterArea), next(letterArea);
+	for (unsigned int d = 1; d < this->dimensions; d++) {
+		for (unsigned int p = 0; p < letterArea; p++) component[p] = double((p * 7919 + d * 104729) % 1009) / 1009 - 0.5;
+		for (unsigned int iteration = 0; iteration <= TILE_ITERATIONS; iteration++) {
+			// The component is kept orthogonal to the earlier ones, which also removes the average
+			for (unsigned int e = 0; e < d; e++) {
+				double dot = 0;
+				for (unsigned int p = 0; p < letterArea; p++) dot += component[p] * basis[e * letterArea + p];
+				for (unsigned int p = 0; p < letterArea; p++) component[p] -= dot * basis[e * letterArea + p];
+			}
+			double length = 0;
+			for (unsigned int p = 0; p < letterArea; p++) length += component[p] * component[p];
+			length = std::sqrt(length);
+			if (length < 1e-9) break; // the letters don't vary in any more directions
+			for (unsigned int p = 0; p < letterArea; p++) component[p] /= length;
+			if (iteration == TILE_ITERATIONS) {
+				for (unsigned int p = 0; p < letterArea; p++) basis[d * letterArea + p] = component[p];
+				break;
+			}
+			for (unsigned int p = 0; p < letterArea; p++) {
+				next[p] = 0;
+				for (unsigned int q = 0; q < letterArea; q++) next[p] += covariances[p * letterArea + q] * component[q];
+			}
+			component.swap(next);
+		}
+	}
+
+	// The projections of the coverages and of a single color, a tile is then the background color times the latter
+	// plus the difference of the foreground and background colors times the former for every color channel
+	std::vector<float> projections(variants * this->dimensions, 0.0f);
+	std::vector<float> sums(this->dimensions, 0.0f);
+	for (unsigned int d = 0; d < this->dimensions; d++) {
+		const float *component = &basis[d * letterArea];
+		for (unsigned int p = 0; p < letterArea; p++) sums[d] += component[p];
+		for (unsigned int v = 0; v < variants; v++) {
+			const float *coverage = &coverages[v * letterArea];
+			float &projection = projections[v * this->dimensions + d];
+			for (unsigned int p = 0; p < letterArea; p++) projection += component[p] * coverage[p];
+		}
+	}
+
+	unsigned char palette[16][3];
+	getMatchColors(palette);
+	const unsigned int values = this->dimensions * 3;
+	for (unsigned int v = 0; v < variants; v++) {
+		Result tile;
+		tile.c = v / 4;
+		tile.bold = (v / 2) % 2;
+		tile.underline = v % 2;
+		for (tile.fg = 0; tile.fg < 8; tile.fg++) {
+			for (tile.bg = 0; tile.bg < 8; tile.bg++) {
+				// This can be skipped because one of the letters should be empty (space character)
+				if (!tile.bold && tile.fg == tile.bg) continue;
+				const unsigned char *fgColor = palette[tile.bold ? tile.fg + 8 : tile.fg];
+				const unsigned char *bgColor = palette[tile.bg];
+				for (unsigned int d = 0; d < this->dimensions; d++) {
+					for (unsigned int i = 0; i < 3; i++) {
+						points.push_back(bgColor[i] * sums[d] + (fgColor[i] - bgColor[i]) * projections[v * this->dimensions + d]);
+					}
+				}
+				tiles.push_back(tile);
+			}
+		}
+	}
+
+	// The tiles and their points are sorted into the order of the leaves of the tree
+	std::vector<unsigned int> order(tiles.size());
+	for (unsigned int t = 0; t < order.size(); t++) order[t] = t;
+	build(order, 0, order.size());
+	std::vector<float> sortedPoints(points.size());
+	std::vector<Result> sortedTiles(tiles.size());
+	for (unsigned int t = 0; t < order.size(); t++) {
+		std::copy(&points[order[t] * values], &points[(order[t] + 1) * values], &sortedPoints[t * values]);
+		sortedTiles[t] = tiles[order[t]];
+	}
+	points.swap(sortedPoints);
+	tiles.swap(sortedTiles);
+}
+
+// Splits the tiles at the median of the value that varies the most and returns the index of the node
+unsigned int TileIndex::build(std::vector<unsigned int> &order, const unsigned int first, const unsigned int count) {
+	const unsigned int values = dimensions * 3;
+	Node node;
+	node.dimension = -1;
+	node.split = 0;
+	node.left = first;
+	node.right = first + count;
+	if (count > TILE_LEAF_SIZE) {
+		float spread = 0;
+		for (unsigned int i = 0; i < values; i++) {
+			float minValue = points[order[first] * values + i], maxValue = minValue;
+			for (unsigned int t = first + 1; t < first + count; t++) {
+				minValue = std::min(minValue, points[order[t] * values + i]);
+				maxValue = std::max(maxValue, points[order[t] * values + i]);
+			}
+			if (maxValue - minValue > spread) {
+				spread = maxValue - minValue;
+				node.dimension = i;
+			}
+		}
+		if (node.dimension >= 0) {
+			const unsigned int i = node.dimension;
+			std::nth_element(order.begin() + first, order.begin() + first + count / 2, order.begin() + first + count,
+				[&](const unsigned int a, const unsigned int b) { return points[a * values + i] < points[b * values + i]; });
+			node.split = points[order[first + count / 2] * values + i];
+		}
+	}
+
+	const unsigned int index = nodes.size();
+	nodes.push_back(node);
+	if (node.dimension >= 0) {
+		const unsigned int left = build(order, first, count / 2);
+		const unsigned int right = build(order, first + count / 2, count - count / 2);
+		nodes[index].left = left;
+		nodes[index].right = right;
+	}
+	return index;
+}
+
+// Best bin first search, the branches of the tree are visited in the order of their estimated distances
+// until `checks` tiles have been compared
+void TileIndex::search(const unsigned char *input, const unsigned int inputWidth, const unsigned int xs, const unsigned int ys,
+	const unsigned int checks, std::vector<Result> &results) const {
+
+	const unsigned int values = dimensions * 3;
+	const unsigned int letterArea = letterWidth * letterHeight;
+	std::vector<float> query(values, 0.0f);
+	for (unsigned int y = 0; y < letterHeight; y++) {
+		const unsigned char *pixel = &input[(xs + (ys + y) * inputWidth) * 3];
+		for (unsigned int x = 0; x < letterWidth; x++, pixel += 3) {
+			const unsigned int letterPos = x + y * letterWidth;
+			for (unsigned int d = 0; d < dimensions; d++) {
+				const float weight = basis[d * letterArea + letterPos];
+				for (unsigned int i = 0; i < 3; i++) query[d * 3 + i] += weight * pixel[i];
+			}
+		}
+	}
+
+	typedef std::pair<float, unsigned int> Entry; // a distance and a tile or a node
+	std::vector<Entry> best; // a max heap of the closest tiles
+	std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> branches;
+	branches.push(Entry(0.0f, 0));
+	unsigned int checked = 0;
+	while (!branches.empty() && (checked < checks || best.size() < candidates)) {
+		const Entry branch = branches.top();
+		branches.pop();
+		if (best.size() == candidates && branch.first >= best.front().first) break;
+
+		// Go down to the closer leaf and leave the farther branches for later
+		unsigned int n = branch.second;
+		while (nodes[n].dimension >= 0) {
+			const Node &node = nodes[n];
+			const float difference = query[node.dimension] - node.split;
+			branches.push(Entry(branch.first + difference * difference, difference < 0 ? node.right : node.left));
+			n = difference < 0 ? node.left : node.right;
+		}
+
+		for (unsigned int t = nodes[n].left; t < nodes[n].right; t++) {
+			const float *point = &points[t * values];
+			float distance = 0;
+			for (unsigned int i = 0; i < values; i++) distance += (query[i] - point[i]) * (query[i] - point[i]);
+			checked++;
+			if (best.size() < candidates) {
+				best.push_back(Entry(distance, t));
+				std::push_heap(best.begin(), best.end());
+			}
+			else if (distance < best.front().first) {
+				std::pop_heap(best.begin(), best.end());
+				best.back() = Entry(distance, t);
+				std::push_heap(best.begin(), best.end());
+			}
+		}
+	}
+
+	std::sort_heap(best.begin(), best.end());
+	results.clear();
+	for (const Entry &entry : best) results.push_back(tiles[entry.second]);
+}
@@ -0,0 +1,189 @@
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <sstream>
+#include "video.hpp"
+
+#define Y4M_SIGNATURE "YUV4MPEG2 "
+#define Y4M_MAX_LINE 1024
+
+bool VideoInput::open(const char *filepath, const unsigned int rawWidth, const unsigned int rawHeight) {
+	close();
+	file = strcmp(filepath, "-") ? fopen(filepath, "rb") : stdin;
+	if (!file) return false;
+
+	// Raw frames don't have a header, so the bytes that were read are the start of the first frame
+	peeked.resize(strlen(Y4M_SIGNATURE));
+	peeked.resize(fread(peeked.data(), 1, peeked.size(), file));
+	y4m = peeked.size() == strlen(Y4M_SIGNATURE) && !memcmp(peeked.data(), Y4M_SIGNATURE, peeked.size());
+	if (!y4m) {
+		width = rawWidth;
+		height = rawHeight;
+		return width && height;
+	}
+	peeked.clear();
+
+	std::string header;
+	if (!readLine(header)) return false;
+	width = height = 0;
+	mono = fullRange = false;
+	chromaShiftX = chromaShiftY = 1;
+	std::istringstream parameters(header);
+	std::string parameter;
+	while (parameters >> parameter) {
+		const std::string value = parameter.substr(1);
+		if (parameter[0] == 'W') width = atoi(value.c_str());
+		else if (parameter[0] == 'H') height = atoi(value.c_str());
+		else if (parameter[0] == 'X' && value == "COLORRANGE=FULL") fullRange = true;
+		else if (parameter[0] == 'C') {
+			if (value == "420" || value == "420jpeg" || value == "420paldv" || value == "420mpeg2") chromaShiftX = chromaShiftY = 1;
+			else if (value == "422") { chromaShiftX = 1; chromaShiftY = 0; }
+			else if (value == "444") chromaShiftX = chromaShiftY = 0;
+			else if (value == "mono") mono = true;
+			else return false; // more than 8 bits per sample or alpha
+		}
+	}
+	return width && height;
+}
+
+void VideoInput::close() {
+	if (file && file != stdin) fclose(file);
+	file = 0;
+}
+
+bool VideoInput::readBytes(unsigned char *data, const unsigned int size) {
+	const unsigned int fromPeeked = std::min<unsigned int>(peeked.size(), size);
+	memcpy(data, peeked.data(), fromPeeked);
+	peeked.erase(peeked.begin(), peeked.begin() + fromPeeked);
+	return fread(data + fromPeeked, 1, size - fromPeeked, file) == size - fromPeeked;
+}
+
+bool VideoInput::readLine(std::string &line) {
+	line.clear();
+	for (int c = fgetc(file); c != '\n'; c = fgetc(file)) {
+		if (c == EOF || line.size() >= Y4M_MAX_LINE) return false;
+		line += char(c);
+	}
+	return true;
+}
+
+inline unsigned char clampColor(const int value) {
+	return value < 0 ? 0 : value > 255 ? 255 : value;
+}
+
+unsigned char *VideoInput::read(unsigned int &width, unsigned int &height) {
+	if (!file) return 0;
+	width = this->width;
+	height = this->height;
+
+	if (!y4m) {
+		buffer.resize(width * height * 3);
+		if (!readBytes(buffer.data(), buffer.size())) return 0;
+		unsigned char *data = new unsigned char[width * height * 3];
+		for (unsigned int y = 0; y < height; y++) {
+			memcpy(&data[(height - y - 1) * width * 3], &buffer[y * width * 3], width * 3);
+		}
+		return data;
+	}
+
+	// Each frame starts with a line that may contain parameters that are ignored
+	std::string line;
+	if (!readLine(line) || line.compare(0, 5, "FRAME")) return 0;
+	const unsigned int chromaWidth = (width + (1 << chromaShiftX) - 1) >> chromaShiftX;
+	const unsigned int chromaHeight = (height + (1 << chromaShiftY) - 1) >> chromaShiftY;
+	const unsigned int chromaSize = mono ? 0 : chromaWidth * chromaHeight;
+	buffer.resize(width * height + chromaSize * 2);
+	if (!readBytes(buffer.data(), buffer.size())) return 0;
+	const unsigned char *planeY = buffer.data();
+	const unsigned char *planeU = planeY + width * height;
+	const unsigned char *planeV = planeU + chromaSize;
+
+	// BT.601 in 16.16 fixed point, the limited range is scaled to the full range
+	const int scale = fullRange ? 65536 : 76309;
+	const int offset = fullRange ? 0 : 16;
+	const int rv = fullRange ? 91881 : 104597;
+	const int gu = fullRange ? 22554 : 25675;
+	const int gv = fullRange ? 46802 : 53279;
+	const int bu = fullRange ? 116130 : 132201;
+
+	unsigned char *data = new unsigned char[width * height * 3];
+	for (unsigned int y = 0; y < height; y++) {
+		unsigned char *row = &data[(height - y - 1) * width * 3];
+		for (unsigned int x = 0; x < width; x++) {
+			const int luma = (planeY[x + y * width] - offset) * scale + 32768;
+			int u = 0, v = 0;
+			if (!mono) {
+				const unsigned int chroma = (x >> chromaShiftX) + (y >> chromaShiftY) * chromaWidth;
+				u = planeU[chroma] - 128;
+				v = planeV[chroma] - 128;
+			}
+			row[x * 3    ] = clampColor((luma + rv * v) >> 16);
+			row[x * 3 + 1] = clampColor((luma - gu * u - gv * v) >> 16);
+			row[x * 3 + 2] = clampColor((luma + bu * u) >> 16);
+		}
+	}
+	return data;
+}
+
+bool VideoOutput::open(const char *filepath, const bool y4m, const unsigned int fps) {
+	close();
+	file = strcmp(filepath, "-") ? fopen(filepath, "wb") : stdout;
+	this->y4m = y4m;
+	this->fps = fps ? fps : 1;
+	width = height = 0;
+	return file != 0;
+}
+
+void VideoOutput::close() {
+	if (file && file != stdout) fclose(file);
+	else if (file) fflush(file);
+	file = 0;
+}
+
+bool VideoOutput::write(TileRenderer &renderer, const std::vector<Result> &results, const unsigned int width, const unsigned int height) {
+	if (!file) return false;
+	const unsigned int letterWidth = renderer.getLetterWidth();
+	const unsigned int letterHeight = renderer.getLetterHeight();
+	const unsigned int frameWidth = width * letterWidth;
+	const unsigned int frameHeight = height * letterHeight;
+	const unsigned int rowSize = frameWidth * 3;
+
+	if (!this->width) {
+		this->width = frameWidth;
+		this->height = frameHeight;
+		if (y4m) fprintf(file, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C444 XCOLORRANGE=FULL\n", frameWidth, frameHeight, fps);
+	}
+	// All frames of a stream must be the same size
+	else if (this->width != frameWidth || this->height != frameHeight) return false;
+
+	band.resize(rowSize * letterHeight);
+	buffer.resize(y4m ? frameWidth * frameHeight * 3 : rowSize * letterHeight);
+	if (y4m) fputs("FRAME\n", file);
+
+	// The results and the rendered images are stored bottom row first
+	for (unsigned int row = height; row > 0; row--) {
+		renderer.render(results, width, row - 1, row, band.data());
+		const unsigned int firstY = (height - row) * letterHeight;
+		for (unsigned int y = 0; y < letterHeight; y++) {
+			const unsigned char *pixels = &band[(letterHeight - y - 1) * rowSize];
+			if (!y4m) {
+				memcpy(&buffer[y * rowSize], pixels, rowSize);
+				continue;
+			}
+			// Full range BT.601 in 16.16 fixed point
+			unsigned char *planeY = &buffer[(firstY + y) * frameWidth];
+			unsigned char *planeU = planeY + frameWidth * frameHeight;
+			unsigned char *planeV = planeU + frameWidth * frameHeight;
+			for (unsigned int x = 0; x < frameWidth; x++) {
+				const int r = pixels[x * 3], g = pixels[x * 3 + 1], b = pixels[x * 3 + 2];
+				planeY[x] = clampColor((19595 * r + 38470 * g + 7471 * b + 32768) >> 16);
+				planeU[x] = clampColor((-11059 * r - 21709 * g + 32768 * b + 8421376) >> 16);
+				planeV[x] = clampColor((32768 * r - 27439 * g - 5329 * b + 8421376) >> 16);
+			}
+		}
+		if (!y4m && fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size()) return false;
+	}
+
+	if (y4m && fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size()) return false;
+	return true;
+}
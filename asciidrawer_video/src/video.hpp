@@ -0,0 +1,56 @@
+#ifndef VIDEO_HPP
+#define VIDEO_HPP
+
+#include <cstdio>
+#include <vector>
+#include <string>
+#include "asciidrawer.hpp"
+
+/*
+	Reads frames from a Y4M stream or raw rgb24 frames, which is detected from the start of the stream.
+	Y4M streams can be 4:2:0, 4:2:2, 4:4:4 or mono with 8 bits per sample and are converted to RGB with BT.601.
+	Raw rgb24 frames don't have a header, so their size has to be given when opening the stream.
+*/
+class VideoInput {
+	public:
+		VideoInput(): file(0) {}
+		~VideoInput() { close(); }
+		// "-" is the standard input
+		bool open(const char *filepath, const unsigned int rawWidth, const unsigned int rawHeight);
+		// Returns the next frame bottom row first like loadPNG or 0 at the end of the stream
+		unsigned char *read(unsigned int &width, unsigned int &height);
+		void close();
+	private:
+		FILE *file;
+		bool y4m, mono, fullRange;
+		unsigned int width, height;
+		unsigned int chromaShiftX, chromaShiftY; // the chroma planes are smaller by these powers of two
+		std::vector<unsigned char> buffer; // reused between frames
+		std::vector<unsigned char> peeked; // the bytes that were read when detecting the format
+		bool readBytes(unsigned char *data, const unsigned int size);
+		bool readLine(std::string &line);
+};
+
+/*
+	Writes the result images as a Y4M stream or raw rgb24 frames.
+	Y4M streams are 4:4:4 with the full range of BT.601, so the colors only change by the rounding.
+*/
+class VideoOutput {
+	public:
+		VideoOutput(): file(0) {}
+		~VideoOutput() { close(); }
+		// "-" is the standard output
+		bool open(const char *filepath, const bool y4m, const unsigned int fps);
+		// Renders the results one row of letters at a time, starting from the top row which is written first
+		bool write(TileRenderer &renderer, const std::vector<Result> &results, const unsigned int width, const unsigned int height);
+		void close();
+	private:
+		FILE *file;
+		bool y4m;
+		unsigned int fps;
+		unsigned int width, height; // in pixels, written into the Y4M header with the first frame
+		std::vector<unsigned char> band; // a rendered row of letters, reused between frames
+		std::vector<unsigned char> buffer; // the rows in the output order or the Y4M planes, reused between frames
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef CONFIGS_HPP
+#define CONFIGS_HPP
+
+#include "../src/settings.hpp"
+
+/*
+	The configurations of the golden test for "make check_configs", which compiles everything with
+	"-include test/configs.hpp" and GOLDEN_CONFIG set to each configuration, see the Makefile.
+	Every configuration enables an optional matching path. The ones that mustn't change the results are compared
+	to the normal golden results and the others have their own golden results named by GOLDEN_NAME.
+	With GOLDEN_SHARED the configuration is compared to the golden results of an earlier one with the same name.
+*/
+
+#if GOLDEN_CONFIG == 1
+	#define GOLDEN_NAME "patch-cache"
+	#undef PATCH_CACHE_SIZE
+	#undef PATCH_CACHE_BITS
+	#define PATCH_CACHE_SIZE 100000
+	#define PATCH_CACHE_BITS 2
+#elif GOLDEN_CONFIG == 2
+	// The same results as without it, the blocks aren't used with the normal threshold
+	#undef PYRAMID_BLOCK
+	#define PYRAMID_BLOCK 4
+#elif GOLDEN_CONFIG == 3
+	#define GOLDEN_NAME "tile-index"
+	#undef TILE_INDEX_CHECKS
+	#define TILE_INDEX_CHECKS 256
+#elif GOLDEN_CONFIG == 4
+	#define GOLDEN_NAME "256-colors"
+	#undef COLOR_MODE
+	#define COLOR_MODE 1
+#elif GOLDEN_CONFIG == 5
+	#define GOLDEN_NAME "true-colors"
+	#undef COLOR_MODE
+	#define COLOR_MODE 2
+#elif GOLDEN_CONFIG == 6
+	#define GOLDEN_NAME "blocks"
+	#undef BLOCK_MODE
+	#define BLOCK_MODE
+#elif GOLDEN_CONFIG == 7
+	#define GOLDEN_NAME "uniform"
+	#undef UNIFORM_VARIANCE
+	#define UNIFORM_VARIANCE 20
+#elif GOLDEN_CONFIG == 8
+	// The same results as without it
+	#undef NUMA_FIRST_TOUCH
+	#define NUMA_FIRST_TOUCH
+#elif GOLDEN_CONFIG == 9
+	#define GOLDEN_NAME "exact"
+	#undef QUALITY_THRESHOLD
+	#define QUALITY_THRESHOLD 1.0f
+#elif GOLDEN_CONFIG == 10
+	// The same results as configuration 9, the blocks skip letters with the threshold 1
+	#define GOLDEN_NAME "exact"
+	#define GOLDEN_SHARED
+	#undef QUALITY_THRESHOLD
+	#define QUALITY_THRESHOLD 1.0f
+	#undef PYRAMID_BLOCK
+	#define PYRAMID_BLOCK 4
+#endif
+
+#endif
@@ -0,0 +1,256 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include "../src/asciidrawer.hpp"
+#include "../src/settings.hpp"
+
+/*
+	Converts fixed inputs and compares the results and the result images to the ones stored in test/golden.
+	Returns 1 if anything differs or, with --timing, if the matching has become too slow.
+
+	--update          store the current results as the new golden results
+	--tolerance 0.01  allow this fraction of the letters to differ and this much mean difference
+	                  in the result images relative to 255, the default is 0 meaning exact results
+	--timing          also compare the time of the matching to the timing stored in GOLDEN_TIMING
+	--budget 0.25     allow the matching to be this much slower than the stored timing
+
+	The timing depends on the computer, so it isn't stored with the golden results and is only compared with --timing
+	("make check_timing"). The timing is stored the first time, so run it first without the change that is measured.
+	"make check_configs" compiles and runs the test with each configuration of test/configs.hpp.
+*/
+
+#define GOLDEN_PATH "test/golden/"
+#define GOLDEN_TIMING GOLDEN_PATH "timing.txt"
+#define GOLDEN_WIDTH 48
+
+// The configurations of test/configs.hpp that change the results have their own golden results
+#ifdef GOLDEN_NAME
+	#define GOLDEN_SUFFIX "-" GOLDEN_NAME
+#else
+	#define GOLDEN_SUFFIX ""
+#endif
+
+struct Frame {
+	std::string name;
+	unsigned int width, height;
+	std::unique_ptr<unsigned char[]> data;
+};
+
+unsigned char *loadPNG(const char *filename, unsigned int &width, unsigned int &height, unsigned int &_channels);
+
+// The video version tests the previous results first, so the second frame is the first one moved to the right
+const bool USE_PREVIOUS = true;
+// matchBatch doesn't test the previous results, so it isn't compared here
+const bool TEST_BATCH = false;
+
+std::vector<Frame> loadFrames() {
+	std::vector<Frame> frames(2);
+	unsigned int channels;
+	frames[0].name = "00000";
+	frames[0].data.reset(loadPNG("inputs/00000.png", frames[0].width, frames[0].height, channels));
+	if (!frames[0].data || channels != 3) return std::vector<Frame>();
+
+	const unsigned int width = frames[0].width;
+	const unsigned int height = frames[0].height;
+	frames[1].name = "00000-moved";
+	frames[1].width = width;
+	frames[1].height = height;
+	frames[1].data.reset(new unsigned char[width * height * 3]);
+	for (unsigned int y = 0; y < height; y++) {
+		for (unsigned int x = 0; x < width; x++) {
+			const unsigned int x2 = x < 20 ? 0 : x - 20;
+			for (unsigned int i = 0; i < 3; i++) frames[1].data[(x + y * width) * 3 + i] = frames[0].data[(x2 + y * width) * 3 + i];
+		}
+	}
+	return frames;
+}
+
+bool saveResults(const std::vector<Result> &results, const unsigned int width, const unsigned int height, const std::string &filepath) {
+	std::ofstream file(filepath.c_str(), std::ios::binary);
+	const unsigned char header[8] = {'A', 'S', 'C', 'G', (unsigned char)width, (unsigned char)(width >> 8), (unsigned char)height, (unsigned char)(height >> 8)};
+	file.write((const char*)header, 8);
+	for (const auto &result : results) {
+		// The colors take 3 bytes so that true colors fit
+		const unsigned char cell[9] = {result.c, (unsigned char)result.fg, (unsigned char)(result.fg >> 8), (unsigned char)(result.fg >> 16),
+			(unsigned char)result.bg, (unsigned char)(result.bg >> 8), (unsigned char)(result.bg >> 16), result.bold, result.underline};
+		file.write((const char*)cell, 9);
+	}
+	return file.good();
+}
+
+bool loadResults(std::vector<Result> &results, unsigned int &width, unsigned int &height, const std::string &filepath) {
+	std::ifstream file(filepath.c_str(), std::ios::binary);
+	unsigned char header[8];
+	if (!file.read((char*)header, 8) || memcmp(header, "ASCG", 4)) return false;
+	width = header[4] | (header[5] << 8);
+	height = header[6] | (header[7] << 8);
+	results.assign(width * height, Result());
+	for (auto &result : results) {
+		unsigned char cell[9];
+		if (!file.read((char*)cell, 9)) return false;
+		result.c = cell[0];
+		result.fg = cell[1] | (cell[2] << 8) | (cell[3] << 16);
+		result.bg = cell[4] | (cell[5] << 8) | (cell[6] << 16);
+		result.bold = cell[7];
+		result.underline = cell[8];
+	}
+	return true;
+}
+
+int main(int argc, char **argv) {
+	bool update = false, timing = false;
+	double tolerance = 0, budget = 0.25;
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--update")) update = true;
+		else if (!strcmp(argv[i], "--timing")) timing = true;
+		else if (!strcmp(argv[i], "--tolerance") && i + 1 < argc) tolerance = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--budget") && i + 1 < argc) budget = atof(argv[++i]);
+		else {
+			std::cerr << "Unknown argument " << argv[i] << std::endl;
+			return 1;
+		}
+	}
+
+	#if defined(GOLDEN_CONFIG) && (!defined(GOLDEN_NAME) || defined(GOLDEN_SHARED))
+		// This configuration is compared to the golden results of another configuration, which only that one updates
+		if (update) {
+			std::cout << "The configuration " << GOLDEN_CONFIG << " doesn't have its own golden results" << std::endl;
+			return 0;
+		}
+	#endif
+
+	Font font;
+	if (!loadFont(font)) {
+		std::cout << "Couldn't load the font" << std::endl;
+		return 1;
+	}
+	const std::vector<Frame> frames = loadFrames();
+	if (frames.empty()) {
+		std::cout << "Couldn't load the inputs" << std::endl;
+		return 1;
+	}
+
+	MatchSettings matchSettings;
+	matchSettings.threshold = QUALITY_THRESHOLD;
+	matchSettings.showProgress = false;
+	#ifdef PATCH_CACHE_SIZE
+		PatchCache patchCache(PATCH_CACHE_SIZE, PATCH_CACHE_BITS);
+		matchSettings.patchCache = &patchCache;
+	#endif
+	#ifdef TILE_INDEX_CHECKS
+		const TileIndex tileIndex(font, TILE_INDEX_DIMENSIONS, TILE_INDEX_CANDIDATES);
+		matchSettings.tileIndex = &tileIndex;
+		matchSettings.tileChecks = TILE_INDEX_CHECKS;
+	#endif
+	TileRenderer renderer(font);
+	std::vector<Result> results;
+	double matchTime = 0;
+	bool failed = false;
+
+	for (unsigned int f = 0; f < frames.size(); f++) {
+		const Frame &frame = frames[f];
+		const unsigned int width = GOLDEN_WIDTH;
+		const unsigned int height = (font.letterWidth * frame.height * width + (font.letterHeight * frame.width - 1)) / font.letterHeight / frame.width;
+		const unsigned int outputWidth = width * font.letterWidth;
+		const unsigned int outputHeight = height * font.letterHeight;
+
+		std::unique_ptr<unsigned char[]> input;
+		if (outputWidth > frame.width || outputHeight > frame.height) input.reset(scaleUp(frame.data.get(), frame.width, frame.height, outputWidth, outputHeight));
+		else if (outputWidth != frame.width || outputHeight != frame.height) input.reset(scaleDown(frame.data.get(), frame.width, frame.height, outputWidth, outputHeight));
+		else {
+			input.reset(new unsigned char[outputWidth * outputHeight * 3]);
+			memcpy(input.get(), frame.data.get(), outputWidth * outputHeight * 3);
+		}
+
+		matchSettings.usePrevious = USE_PREVIOUS && f > 0;
+		const auto start = std::chrono::high_resolution_clock::now();
+		matchResults(font, input.get(), width, height, matchSettings, results);
+		matchTime += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start).count() / 1000000.0;
+
+		if (TEST_BATCH && !update) {
+			// Two copies so that the letter positions of the images are shared by the threads
+			std::vector<Result> batchResults[2];
+			std::vector<MatchJob> jobs(2);
+			for (unsigned int j = 0; j < 2; j++) {
+				jobs[j].input = input.get();
+				jobs[j].width = width;
+				jobs[j].height = height;
+				jobs[j].results = &batchResults[j];
+			}
+			matchBatch(font, jobs, matchSettings);
+			const bool passed = batchResults[0] == results && batchResults[1] == results;
+			std::cout << frame.name << ": batch " << (passed ? "passed" : "FAILED, the results differ from matchResults") << std::endl;
+			if (!passed) failed = true;
+		}
+
+		const std::unique_ptr<unsigned char[]> image(new unsigned char[outputWidth * outputHeight * 3]);
+		renderer.render(results, width, 0, height, image.get());
+
+		const std::string resultsPath = GOLDEN_PATH + frame.name + GOLDEN_SUFFIX ".results";
+		const std::string imagePath = GOLDEN_PATH + frame.name + GOLDEN_SUFFIX ".bmp";
+		if (update) {
+			if (!saveResults(results, width, height, resultsPath) || !saveBMP(image.get(), imagePath.c_str(), outputWidth, outputHeight)) {
+				std::cout << "Couldn't save the golden results of " << frame.name << std::endl;
+				return 1;
+			}
+			std::cout << frame.name << ": updated" << std::endl;
+			continue;
+		}
+
+		// Compare the results
+		std::vector<Result> golden;
+		unsigned int goldenWidth, goldenHeight;
+		if (!loadResults(golden, goldenWidth, goldenHeight, resultsPath) || goldenWidth != width || goldenHeight != height) {
+			std::cout << frame.name << ": FAILED, couldn't load matching golden results" << std::endl;
+			failed = true;
+			continue;
+		}
+		unsigned int differences = 0;
+		for (unsigned int i = 0; i < results.size(); i++) {
+			if (results[i] == golden[i]) continue;
+			if (differences < 5) {
+				std::cout << frame.name << ": letter " << (i % width) << ", " << (height - i / width - 1) << " is "
+					<< (int)results[i].c << " " << results[i].fg << " " << results[i].bg << " " << results[i].bold << " " << results[i].underline
+					<< " instead of " << (int)golden[i].c << " " << golden[i].fg << " " << golden[i].bg << " " << golden[i].bold << " " << golden[i].underline << std::endl;
+			}
+			differences++;
+		}
+
+		// Compare the images
+		unsigned int goldenImageWidth, goldenImageHeight;
+		const std::unique_ptr<unsigned char[]> goldenImage(loadBMP(imagePath.c_str(), goldenImageWidth, goldenImageHeight));
+		if (!goldenImage || goldenImageWidth != outputWidth || goldenImageHeight != outputHeight) {
+			std::cout << frame.name << ": FAILED, couldn't load a matching golden image" << std::endl;
+			failed = true;
+			continue;
+		}
+		double imageDifference = 0;
+		for (unsigned int i = 0; i < outputWidth * outputHeight * 3; i++) imageDifference += abs(image[i] - goldenImage[i]);
+		imageDifference /= outputWidth * outputHeight * 3 * 255.0;
+
+		const bool passed = differences <= tolerance * results.size() && imageDifference <= tolerance;
+		std::cout << frame.name << ": " << (passed ? "passed" : "FAILED") << ", " << differences << " / " << results.size()
+			<< " letters differ, mean image difference " << imageDifference << std::endl;
+		if (!passed) failed = true;
+	}
+
+	// Compare the timing
+	std::cout << "Matching took " << matchTime << " ms" << std::endl;
+	double goldenTime = 0;
+	if (!timing) return failed ? 1 : 0;
+	if (!update && std::ifstream(GOLDEN_TIMING) >> goldenTime) {
+		const bool passed = matchTime <= goldenTime * (1.0 + budget);
+		std::cout << "Timing: " << (passed ? "passed" : "FAILED") << ", the limit is " << goldenTime * (1.0 + budget) << " ms" << std::endl;
+		if (!passed) failed = true;
+	}
+	else {
+		std::ofstream(GOLDEN_TIMING) << matchTime << std::endl;
+		std::cout << "Timing: stored into " << GOLDEN_TIMING << std::endl;
+	}
+
+	return failed ? 1 : 0;
+}